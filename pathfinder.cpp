@@ -2,22 +2,1277 @@
 #include <fstream>
 #include <string>
 #include <cstring>  
+#include <cctype>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <string_view>
+#ifdef _WIN32 // file mapping for snapshots and JSON, see MappedFile
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#define NOGDI
+#include <windows.h>
+#undef near
+#undef far
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h> // quote scan in the schema JSON parser
+#endif
 #include "json.hpp" //json lib to read json graph data file
 
 using json = nlohmann::json;
 using namespace std;
 
+// Read-only mapping of a whole file, used for snapshots and the JSON
+// loaders: mmap on POSIX, a file mapping view on Windows (MSYS2 has no
+// sys/mman.h). release() hands the view to the caller, who frees it with
+// unmap().
+struct MappedFile {
+    const char* data;
+    long long size;
+    MappedFile() : data(nullptr), size(0) {}
+    ~MappedFile() {
+        unmap(data, size);
+    }
+    bool open(const char* filename) {
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER length;
+        size = GetFileSizeEx(handle, &length) ? length.QuadPart : 0;
+        if (size == 0) {
+            CloseHandle(handle);
+            return true; // empty: no mapping, the parsers reject it
+        }
+        HANDLE mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(handle);
+        void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (mapping != nullptr) CloseHandle(mapping); // the view keeps the mapping alive
+        if (view == nullptr) {
+            size = 0;
+            return false;
+        }
+        data = (const char*)view;
+        return true;
+#else
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        size = fstat(fd, &info) == 0 ? info.st_size : 0;
+        if (size == 0) {
+            close(fd);
+            return true; // empty: no mapping, the parsers reject it
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            size = 0;
+            return false;
+        }
+        data = (const char*)mapping;
+        return true;
+#endif
+    }
+    void release() {
+        data = nullptr;
+        size = 0;
+    }
+    static void unmap(const char* data, long long size) {
+        if (data == nullptr) return;
+#ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(data);
+#else
+        munmap((void*)data, size);
+#endif
+    }
+};
+
+// Graph snapshot sections
+// A snapshot is a header followed by arrays ("sections"), each stored as its
+// byte length (8 bytes) and the raw array padded to 8 bytes, so every array
+// in a mapped file is aligned and can be used in place. The checksum runs
+// over the section words as they are written or mapped.
+// For the embedded build the same sections are written as C++ source
+// instead: one typed constexpr array per section plus a table of
+// EmbeddedSection entries in section order, see writeEmbeddedHeader().
+struct EmbeddedSection {
+    const void* data; // a constexpr array of the section's element type, or null when empty
+    long long count;
+    int elementSize;
+};
+
+// element types a section can hold, for the embedded header
+const char* sectionType(const char*) { return "char"; }
+const char* sectionType(const unsigned char*) { return "unsigned char"; }
+const char* sectionType(const int*) { return "int"; }
+void writeSectionValue(ostream& out, int value) { out << value; }
+void writeSectionValue(ostream& out, unsigned char value) { out << (int)value; }
+void writeSectionValue(ostream& out, char value) {
+    if (value >= ' ' && value <= '~' && value != '\'' && value != '\\') {
+        out << '\'' << value << '\'';
+    } else if (value == '\0') {
+        out << "'\\0'";
+    } else {
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "'\\x%02x'", (unsigned char)value);
+        out << escaped;
+    }
+}
+
+class SnapshotWriter {
+private:
+    ostream& out;
+    bool asArrays; // C++ arrays for the embedded header instead of binary sections
+    unsigned long long hash;
+    void mix(const char* data, long long bytes) {
+        for (long long i = 0; i < bytes; i += 8) {
+            unsigned long long word = 0;
+            memcpy(&word, data + i, bytes - i < 8 ? bytes - i : 8);
+            hash = (hash ^ word) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        }
+    }
+    template <class T>
+    void writeArray(const string& label, const T* data, long long count) {
+        string type = sectionType(data);
+        string name = "EMBEDDED_GRAPH_" + label;
+        if (count == 0) {
+            sectionTable += "    {nullptr, 0, sizeof(" + type + ")},\n";
+            return;
+        }
+        out << "constexpr " << type << " " << name << "[] = {";
+        for (long long i = 0; i < count; ++i) {
+            out << (i % 16 == 0 ? "\n    " : " ");
+            writeSectionValue(out, data[i]);
+            out << ",";
+        }
+        out << "\n};\n";
+        sectionTable += "    {" + name + ", " + to_string(count) + ", sizeof(" + type + ")},\n";
+    }
+public:
+    long long payloadBytes;
+    int numSections;
+    string sectionTable; // asArrays: the EmbeddedSection entries so far
+    SnapshotWriter(ostream& stream, bool arrays = false)
+        : out(stream), asArrays(arrays), hash(14695981039346656037ULL), payloadBytes(0), numSections(0) {}
+    // 'label' names the array in the embedded header
+    template <class T>
+    void write(const string& label, const T* data, long long count) {
+        static const char padding[8] = {0};
+        long long length = count * (long long)sizeof(T);
+        long long padded = (length + 7) & ~7LL;
+        payloadBytes += sizeof(length) + padded;
+        numSections++;
+        if (asArrays) {
+            writeArray(label, data, count);
+            return;
+        }
+        out.write((const char*)&length, sizeof(length));
+        mix((const char*)&length, sizeof(length));
+        if (length > 0) out.write((const char*)data, length);
+        mix((const char*)data, length);
+        out.write(padding, padded - length);
+    }
+    unsigned long long checksum() const {
+        return hash;
+    }
+};
+
+// Hands out the sections of a mapped snapshot, or the typed arrays of the
+// embedded build, in the order they were written. A section with an
+// unexpected size marks the whole reader as failed. The pointers are not
+// const because the owners keep plain pointers, but borrowed arrays are
+// never written.
+class SnapshotReader {
+private:
+    char* cursor;
+    char* end;
+    const EmbeddedSection* section; // embedded build: next typed section
+    const EmbeddedSection* lastSection;
+public:
+    bool ok;
+    SnapshotReader(char* begin, char* stop)
+        : cursor(begin), end(stop), section(nullptr), lastSection(nullptr), ok(true) {}
+    SnapshotReader(const EmbeddedSection* sections, int count)
+        : cursor(nullptr), end(nullptr), section(sections), lastSection(sections + count), ok(true) {}
+    // next section, whatever its length; count receives the element count
+    template <class T>
+    T* takeAny(long long& count) {
+        return take<T>(-1, &count);
+    }
+    // next section, which must hold exactly 'expected' elements
+    template <class T>
+    T* take(long long expected, long long* count = nullptr) {
+        if (section != nullptr) return takeTyped<T>(expected, count);
+        if (!ok || end - cursor < 8) {
+            ok = false;
+            return nullptr;
+        }
+        long long bytes;
+        memcpy(&bytes, cursor, sizeof(bytes));
+        long long padded = (bytes + 7) & ~7LL;
+        if (bytes < 0 || bytes % (long long)sizeof(T) != 0 || end - cursor - 8 < padded ||
+            (expected >= 0 && bytes != expected * (long long)sizeof(T))) {
+            ok = false;
+            return nullptr;
+        }
+        T* data = bytes > 0 ? (T*)(cursor + 8) : nullptr;
+        if (count != nullptr) *count = bytes / sizeof(T);
+        cursor += 8 + padded;
+        return data;
+    }
+    // an embedded section is declared as an array of T, so it is handed out as is
+    template <class T>
+    T* takeTyped(long long expected, long long* count) {
+        if (!ok || section == lastSection || section->elementSize != (int)sizeof(T) || section->count < 0 ||
+            (expected >= 0 && section->count != expected) || (section->count > 0) != (section->data != nullptr)) {
+            ok = false;
+            return nullptr;
+        }
+        T* data = const_cast<T*>(static_cast<const T*>(section->data));
+        if (count != nullptr) *count = section->count;
+        section++;
+        return data;
+    }
+    // checksum of [begin, stop), the same mix as SnapshotWriter
+    static unsigned long long checksum(const char* begin, const char* stop) {
+        unsigned long long hash = 14695981039346656037ULL;
+        for (const char* p = begin; p < stop; p += 8) {
+            unsigned long long word;
+            memcpy(&word, p, 8);
+            hash = (hash ^ word) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+};
+
+// Interned name pool
+// Every node name lives once in a single character arena, NUL-terminated so it
+// can still be handed out as a C string; names are addressed by id through an
+// offset and a length. The node map, the perfect hash and the door search all
+// refer to names by id instead of keeping copies. The arena is sized up front
+// when the caller knows the total and doubles otherwise.
+class NamePool {
+private:
+    char* chars;
+    int charCount;
+    int charCapacity;
+    int* offsets;
+    int* lengths;
+    int count;
+    int idCapacity;
+    bool borrowed; // arrays live in a mapped snapshot
+public:
+    NamePool(int expectedNames, int expectedChars) : charCount(0), count(0), borrowed(false) {
+        idCapacity = expectedNames > 16 ? expectedNames : 16;
+        charCapacity = expectedChars > 0 ? expectedChars : idCapacity * 8;
+        chars = new char[charCapacity];
+        offsets = new int[idCapacity];
+        lengths = new int[idCapacity];
+    }
+    ~NamePool() {
+        if (borrowed) return;
+        delete[] chars;
+        delete[] offsets;
+        delete[] lengths;
+    }
+    int size() const {
+        return count;
+    }
+    // Appends a name and returns its id; callers check for duplicates first.
+    int intern(const char* name, int length) {
+        if (charCount + length + 1 > charCapacity) {
+            int grownCapacity = charCapacity * 2;
+            while (charCount + length + 1 > grownCapacity) grownCapacity *= 2;
+            char* grown = new char[grownCapacity];
+            memcpy(grown, chars, charCount);
+            delete[] chars;
+            chars = grown;
+            charCapacity = grownCapacity;
+        }
+        if (count == idCapacity) {
+            idCapacity *= 2;
+            int* grownOffsets = new int[idCapacity];
+            int* grownLengths = new int[idCapacity];
+            memcpy(grownOffsets, offsets, count * sizeof(int));
+            memcpy(grownLengths, lengths, count * sizeof(int));
+            delete[] offsets;
+            delete[] lengths;
+            offsets = grownOffsets;
+            lengths = grownLengths;
+        }
+        offsets[count] = charCount;
+        lengths[count] = length;
+        memcpy(chars + charCount, name, length);
+        chars[charCount + length] = '\0';
+        charCount += length + 1;
+        return count++;
+    }
+    const char* c_str(int id) const {
+        return chars + offsets[id];
+    }
+    int length(int id) const {
+        return lengths[id];
+    }
+    string_view view(int id) const {
+        return string_view(chars + offsets[id], lengths[id]);
+    }
+    bool equals(int id, const char* name, int length) const {
+        return lengths[id] == length && memcmp(chars + offsets[id], name, length) == 0;
+    }
+    long long memoryBytes() const {
+        return charCapacity + 2LL * idCapacity * sizeof(int);
+    }
+
+    // 'label' prefixes the section names in the embedded header
+    void writeSnapshot(SnapshotWriter& out, const string& label) const {
+        out.write(label + "_CHARS", chars, charCount);
+        out.write(label + "_OFFSETS", offsets, count);
+        out.write(label + "_LENGTHS", lengths, count);
+    }
+    // Uses the arrays of a mapped snapshot in place; the pool is read-only after.
+    bool readSnapshot(SnapshotReader& in) {
+        long long mappedChars = 0, mappedCount = 0;
+        char* c = in.takeAny<char>(mappedChars);
+        int* o = in.takeAny<int>(mappedCount);
+        int* l = in.take<int>(mappedCount);
+        if (!in.ok) return false;
+        for (long long i = 0; i < mappedCount; ++i) {
+            if (o[i] < 0 || l[i] < 0 || o[i] + (long long)l[i] >= mappedChars || c[o[i] + l[i]] != '\0') return false;
+        }
+        if (!borrowed) {
+            delete[] chars;
+            delete[] offsets;
+            delete[] lengths;
+        }
+        chars = c;
+        offsets = o;
+        lengths = l;
+        charCount = charCapacity = (int)mappedChars;
+        count = idCapacity = (int)mappedCount;
+        borrowed = true;
+        return true;
+    }
+};
+
 // Hash table
-struct HashNode {
-    char key[50];
+// Open addressing with Robin Hood probing: an entry that is further from its
+// home slot than the one it meets takes that slot, so probe lengths stay short
+// and a lookup can stop as soon as it meets an entry closer to home than
+// itself. Each slot keeps the full 32-bit hash (0 = empty) to reject most
+// mismatches without touching the key. Keys are interned in a NamePool, either
+// the table's own or one shared with the graph. The table doubles past 70% load.
+struct HashSlot {
+    unsigned int hash;
+    int keyId; // name id in the NamePool
     int value;
-    HashNode* next;
-    HashNode() : value(0), next(nullptr) { key[0] = '\0'; }
 };
+const char* sectionType(const HashSlot*) { return "HashSlot"; }
+void writeSectionValue(ostream& out, const HashSlot& slot) {
+    out << "{" << slot.hash << "u, " << slot.keyId << ", " << slot.value << "}";
+}
 
 class HashTable {
 private:
-    HashNode** buckets; // pointer to an array of pointers 
+    HashSlot* slots;
+    int capacity; // power of two
+    int count;
+    NamePool* keys;
+    bool ownsKeys;
+    bool borrowedSlots; // slots live in a mapped snapshot
+    // hash function: djb2, then a finalizer so the low bits used for the
+    // slot index depend on every character
+    unsigned int hash(const char* str, int& length) {
+        unsigned int hash = 5381;
+        const char* start = str;
+        int c;
+        while ((c = (unsigned char)*str++)) {
+            hash = (33 * hash) + c;
+        }
+        length = (int)(str - start - 1);
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6bu;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35u;
+        hash ^= hash >> 16;
+        return hash == 0 ? 1 : hash;
+    }
+    int probeDistance(unsigned int hash, int slot) {
+        return (slot - (int)(hash & (capacity - 1))) & (capacity - 1);
+    }
+    // Robin Hood placement of an entry whose key is known to be absent
+    void place(HashSlot entry) {
+        int mask = capacity - 1;
+        int i = entry.hash & mask;
+        int distance = 0;
+        while (true) {
+            if (slots[i].hash == 0) {
+                slots[i] = entry;
+                return;
+            }
+            int existing = probeDistance(slots[i].hash, i);
+            if (existing < distance) {
+                HashSlot displaced = slots[i];
+                slots[i] = entry;
+                entry = displaced;
+                distance = existing;
+            }
+            i = (i + 1) & mask;
+            distance++;
+        }
+    }
+    void grow() {
+        HashSlot* old = slots;
+        int oldCapacity = capacity;
+        capacity *= 2;
+        slots = new HashSlot[capacity];
+        for (int i = 0; i < capacity; ++i) slots[i].hash = 0;
+        for (int i = 0; i < oldCapacity; ++i) {
+            if (old[i].hash != 0) place(old[i]);
+        }
+        delete[] old;
+    }
+public:
+    HashTable(int size, NamePool* sharedKeys = nullptr) : count(0), borrowedSlots(false) {
+        capacity = 16;
+        while (capacity < size) capacity *= 2;
+        slots = new HashSlot[capacity];
+        for (int i = 0; i < capacity; ++i) slots[i].hash = 0;
+        ownsKeys = sharedKeys == nullptr;
+        keys = ownsKeys ? new NamePool(capacity / 2, 0) : sharedKeys;
+    }
+    ~HashTable() {
+        if (!borrowedSlots) delete[] slots;
+        if (ownsKeys) delete keys;
+    }
+    int size() {
+        return count;
+    }
+    const NamePool* keyNames() const {
+        return keys;
+    }
+    void insert(const char* key, int value) {
+        int length;
+        unsigned int h = hash(key, length);
+        int mask = capacity - 1;
+        int i = h & mask;
+        int distance = 0;
+        // update in place if the key is already there
+        while (slots[i].hash != 0 && probeDistance(slots[i].hash, i) >= distance) {
+            if (slots[i].hash == h && keys->equals(slots[i].keyId, key, length)) {
+                slots[i].value = value;
+                return;
+            }
+            i = (i + 1) & mask;
+            distance++;
+        }
+        if ((count + 1) * 10 > capacity * 7) grow();
+        HashSlot entry;
+        entry.hash = h;
+        entry.keyId = keys->intern(key, length);
+        entry.value = value;
+        place(entry);
+        count++;
+    }
+    int get(const char* key) {
+        int length;
+        unsigned int h = hash(key, length);
+        int mask = capacity - 1;
+        int i = h & mask;
+        int distance = 0;
+        while (slots[i].hash != 0 && probeDistance(slots[i].hash, i) >= distance) {
+            if (slots[i].hash == h && keys->equals(slots[i].keyId, key, length)) {
+                return slots[i].value;
+            }
+            i = (i + 1) & mask;
+            distance++;
+        }
+        return -1;
+    }
+    long long memoryBytes() {
+        return (long long)capacity * sizeof(HashSlot) + (ownsKeys ? keys->memoryBytes() : 0);
+    }
+
+    // Only the slots are written; the keys are the shared pool, which the
+    // owner writes itself. A mapped table answers get() but takes no inserts.
+    void writeSnapshot(SnapshotWriter& out) const {
+        out.write("NODE_MAP_SLOTS", slots, capacity);
+    }
+    bool readSnapshot(SnapshotReader& in) {
+        long long mappedCapacity = 0;
+        HashSlot* mapped = in.takeAny<HashSlot>(mappedCapacity);
+        if (!in.ok || mappedCapacity < 16 || (mappedCapacity & (mappedCapacity - 1)) != 0) return false;
+        int used = 0;
+        for (long long i = 0; i < mappedCapacity; ++i) {
+            if (mapped[i].hash == 0) continue;
+            if (mapped[i].keyId < 0 || mapped[i].keyId >= keys->size()) return false;
+            used++;
+        }
+        if (!borrowedSlots) delete[] slots;
+        slots = mapped;
+        capacity = (int)mappedCapacity;
+        count = used;
+        borrowedSlots = true;
+        return true;
+    }
+};
+
+// Minimal perfect hash for the node IDs (CHD, compress-hash-displace).
+// Built once the node set is final: keys are split into buckets by one part
+// of their hash, and every bucket, largest first, gets the first seed that
+// sends all of its keys to free slots. Buckets of a single key are simply
+// given one of the remaining free slots. A lookup is one seed read, one slot
+// read and one string compare against the stored name to reject unknown IDs.
+class NodeIdPerfectHash {
+private:
+    int numKeys;
+    int numBuckets;
+    int* seeds;      // per bucket: seed >= 0, or -(slot + 1) for a direct slot
+    int* slotValue;  // node index stored in every slot
+    const NamePool* names; // node names, for the verification compare
+    bool borrowed;   // tables live in a mapped snapshot
+
+    static unsigned long long hashKey(const char* key) {
+        int length;
+        return hashKey(key, length);
+    }
+    static unsigned long long hashKey(const char* key, int& length) {
+        // FNV-1a, 64 bit
+        unsigned long long h = 14695981039346656037ULL;
+        const char* start = key;
+        while (*key) {
+            h ^= (unsigned char)*key++;
+            h *= 1099511628211ULL;
+        }
+        length = (int)(key - start);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+    int bucketOf(unsigned long long h) const {
+        return (int)((h >> 32) % (unsigned long long)numBuckets);
+    }
+    int slotOf(unsigned long long h, int seed) const {
+        unsigned int x = (unsigned int)h ^ ((unsigned int)seed * 0x9e3779b9u);
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return (int)(x % (unsigned int)numKeys);
+    }
+
+public:
+    static const int MAX_SEED = 1 << 20;
+    double buildMillis;
+
+    NodeIdPerfectHash() : numKeys(0), numBuckets(0), seeds(nullptr), slotValue(nullptr),
+        names(nullptr), borrowed(false), buildMillis(0.0) {}
+    ~NodeIdPerfectHash() {
+        if (borrowed) return;
+        delete[] seeds;
+        delete[] slotValue;
+    }
+
+    // Returns false if some bucket finds no seed (then the caller keeps using
+    // the regular hash table).
+    bool build(const NamePool* keys, int n) {
+        auto startTime = chrono::steady_clock::now();
+        names = keys;
+        numKeys = n;
+        numBuckets = n / 4 + 1;
+        seeds = new int[numBuckets];
+        slotValue = new int[n > 0 ? n : 1];
+
+        unsigned long long* hashes = new unsigned long long[n > 0 ? n : 1];
+        int* bucketStart = new int[numBuckets + 1];
+        int* bucketKeys = new int[n > 0 ? n : 1];
+        for (int b = 0; b <= numBuckets; ++b) bucketStart[b] = 0;
+        for (int i = 0; i < n; ++i) {
+            hashes[i] = hashKey(keys->c_str(i));
+            bucketStart[bucketOf(hashes[i]) + 1]++;
+        }
+        int largest = 0;
+        for (int b = 0; b < numBuckets; ++b) {
+            if (bucketStart[b + 1] > largest) largest = bucketStart[b + 1];
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        int* fill = new int[numBuckets];
+        for (int b = 0; b < numBuckets; ++b) fill[b] = bucketStart[b];
+        for (int i = 0; i < n; ++i) bucketKeys[fill[bucketOf(hashes[i])]++] = i;
+        delete[] fill;
+
+        bool* taken = new bool[n > 0 ? n : 1];
+        for (int i = 0; i < n; ++i) taken[i] = false;
+        int* trial = new int[largest > 0 ? largest : 1];
+        bool ok = true;
+        int nextFree = 0;
+        // buckets from largest to smallest
+        for (int size = largest; size >= 0 && ok; --size) {
+            for (int b = 0; b < numBuckets && ok; ++b) {
+                int first = bucketStart[b];
+                if (bucketStart[b + 1] - first != size) continue;
+                if (size == 0) {
+                    seeds[b] = 0;
+                    continue;
+                }
+                if (size == 1) {
+                    while (taken[nextFree]) nextFree++;
+                    taken[nextFree] = true;
+                    slotValue[nextFree] = bucketKeys[first];
+                    seeds[b] = -(nextFree + 1);
+                    continue;
+                }
+                int seed = 0;
+                for (; seed < MAX_SEED; ++seed) {
+                    bool fits = true;
+                    for (int k = 0; k < size && fits; ++k) {
+                        int slot = slotOf(hashes[bucketKeys[first + k]], seed);
+                        if (taken[slot]) fits = false;
+                        for (int j = 0; j < k && fits; ++j) {
+                            if (trial[j] == slot) fits = false;
+                        }
+                        trial[k] = slot;
+                    }
+                    if (fits) break;
+                }
+                if (seed == MAX_SEED) {
+                    ok = false;
+                    break;
+                }
+                seeds[b] = seed;
+                for (int k = 0; k < size; ++k) {
+                    taken[trial[k]] = true;
+                    slotValue[trial[k]] = bucketKeys[first + k];
+                }
+            }
+        }
+        delete[] hashes;
+        delete[] bucketStart;
+        delete[] bucketKeys;
+        delete[] taken;
+        delete[] trial;
+        buildMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        return ok;
+    }
+
+    int get(const char* key) const {
+        if (numKeys == 0) return -1;
+        int length;
+        unsigned long long h = hashKey(key, length);
+        int seed = seeds[bucketOf(h)];
+        int slot = seed < 0 ? -seed - 1 : slotOf(h, seed);
+        int index = slotValue[slot];
+        return names->equals(index, key, length) ? index : -1;
+    }
+
+    long long memoryBytes() const {
+        return (long long)numBuckets * sizeof(int) + (long long)numKeys * sizeof(int);
+    }
+
+    void writeSnapshot(SnapshotWriter& out) const {
+        out.write("ID_HASH_SEEDS", seeds, numBuckets);
+        out.write("ID_HASH_SLOTS", slotValue, numKeys);
+    }
+    bool readSnapshot(SnapshotReader& in, const NamePool* keys) {
+        long long buckets = 0;
+        int* mappedSeeds = in.takeAny<int>(buckets);
+        int* mappedSlots = in.take<int>(keys->size());
+        if (!in.ok || buckets != keys->size() / 4 + 1) return false;
+        for (int i = 0; i < keys->size(); ++i) {
+            if (mappedSlots[i] < 0 || mappedSlots[i] >= keys->size()) return false;
+        }
+        for (long long b = 0; b < buckets; ++b) {
+            if (mappedSeeds[b] < -keys->size() || mappedSeeds[b] >= MAX_SEED) return false;
+        }
+        names = keys;
+        numKeys = keys->size();
+        numBuckets = (int)buckets;
+        seeds = mappedSeeds;
+        slotValue = mappedSlots;
+        borrowed = true;
+        return true;
+    }
+};
+
+// Prefix index over the node names for door lookups. Names are sorted by
+// (length, bytes), so all names of one length form a sorted run and the names
+// of that length starting with a given base are one contiguous range found by
+// binary search. Door variants (base plus 1 or 2 characters) are then two
+// ranges: O(log V + k) per lookup.
+class NamePrefixIndex {
+private:
+    const NamePool* names;
+    int* sorted;      // name ids ordered by (length, bytes)
+    int* lengthStart; // run of names of length L is [lengthStart[L], lengthStart[L + 1])
+    int maxLength;
+    bool borrowed;    // arrays live in a mapped snapshot
+
+    bool less(int a, int b) const {
+        if (names->length(a) != names->length(b)) return names->length(a) < names->length(b);
+        return names->view(a) < names->view(b);
+    }
+    // bottom-up merge sort of sorted[0, n)
+    void sortIds(int n) {
+        int* buffer = new int[n > 0 ? n : 1];
+        int* from = sorted;
+        int* to = buffer;
+        for (int width = 1; width < n; width *= 2) {
+            for (int lo = 0; lo < n; lo += 2 * width) {
+                int mid = lo + width < n ? lo + width : n;
+                int hi = lo + 2 * width < n ? lo + 2 * width : n;
+                int i = lo, j = mid, k = lo;
+                while (i < mid && j < hi) to[k++] = less(from[j], from[i]) ? from[j++] : from[i++];
+                while (i < mid) to[k++] = from[i++];
+                while (j < hi) to[k++] = from[j++];
+            }
+            int* swap = from;
+            from = to;
+            to = swap;
+        }
+        if (from != sorted) memcpy(sorted, from, n * sizeof(int));
+        delete[] buffer;
+    }
+
+public:
+    NamePrefixIndex() : names(nullptr), sorted(nullptr), lengthStart(nullptr), maxLength(0), borrowed(false) {}
+    ~NamePrefixIndex() {
+        if (borrowed) return;
+        delete[] sorted;
+        delete[] lengthStart;
+    }
+
+    void build(const NamePool* pool) {
+        names = pool;
+        int n = pool->size();
+        sorted = new int[n > 0 ? n : 1];
+        maxLength = 0;
+        for (int i = 0; i < n; ++i) {
+            sorted[i] = i;
+            if (pool->length(i) > maxLength) maxLength = pool->length(i);
+        }
+        sortIds(n);
+        lengthStart = new int[maxLength + 2];
+        for (int L = 0, i = 0; L <= maxLength + 1; ++L) {
+            while (i < n && names->length(sorted[i]) < L) i++;
+            lengthStart[L] = i;
+        }
+    }
+
+    // Range [begin, end) of sorted positions holding names of exactly
+    // 'length' characters that start with 'prefix'.
+    void findRange(string_view prefix, int length, int& begin, int& end) const {
+        begin = end = 0;
+        if (length > maxLength || length < (int)prefix.size()) return;
+        int lo = lengthStart[length];
+        int hi = lengthStart[length + 1];
+        // first name >= prefix
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (names->view(sorted[mid]).compare(0, prefix.size(), prefix) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        begin = lo;
+        hi = lengthStart[length + 1];
+        // first name whose prefix is past 'prefix'
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (names->view(sorted[mid]).compare(0, prefix.size(), prefix) <= 0) lo = mid + 1;
+            else hi = mid;
+        }
+        end = lo;
+    }
+    int at(int position) const {
+        return sorted[position];
+    }
+
+    long long memoryBytes() const {
+        return (long long)names->size() * sizeof(int) + (long long)(maxLength + 2) * sizeof(int);
+    }
+
+    void writeSnapshot(SnapshotWriter& out) const {
+        out.write("PREFIX_SORTED", sorted, names->size());
+        out.write("PREFIX_LENGTH_START", lengthStart, maxLength + 2);
+    }
+    bool readSnapshot(SnapshotReader& in, const NamePool* pool) {
+        int n = pool->size();
+        long long starts = 0;
+        int* mappedSorted = in.take<int>(n);
+        int* mappedStarts = in.takeAny<int>(starts);
+        if (!in.ok || starts < 2 || mappedStarts[0] != 0 || mappedStarts[starts - 1] != n) return false;
+        for (int i = 0; i < n; ++i) {
+            if (mappedSorted[i] < 0 || mappedSorted[i] >= n) return false;
+        }
+        for (long long L = 0; L + 1 < starts; ++L) {
+            if (mappedStarts[L] > mappedStarts[L + 1]) return false;
+        }
+        names = pool;
+        sorted = mappedSorted;
+        lengthStart = mappedStarts;
+        maxLength = (int)starts - 2;
+        borrowed = true;
+        return true;
+    }
+};
+
+// Door groups: rooms with several entrances (CP30a, CP30b) are grouped under
+// their room ID once, after loading. A node's room is its explicit "room"
+// field when the JSON has one, otherwise its name without a door suffix of
+// 1 or 2 lowercase letters after a digit. The groups are a CSR over node
+// indices: every node sits in exactly one group run, so a room resolves to
+// its doors, and a node to itself, without string work or allocation.
+class DoorGroups {
+private:
+    HashTable* roomIds;  // room ID -> group, for rooms whose ID is not a node name
+    int numGroups;
+    int* groupStart;     // doors of group g are doors[groupStart[g], groupStart[g + 1])
+    int* doors;
+    int* doorPosition;   // position of every node in 'doors'
+    bool borrowed;       // CSR arrays live in a mapped snapshot
+
+    // length of the room ID derived from a node name
+    static int derivedRoomLength(string_view name) {
+        int length = (int)name.size();
+        int letters = 0;
+        while (letters < 2 && letters < length && name[length - 1 - letters] >= 'a' &&
+               name[length - 1 - letters] <= 'z') {
+            letters++;
+        }
+        // door suffixes follow a digit (CP30a, H15t21c), other lowercase
+        // endings are part of the name
+        for (int cut = letters; cut > 0; --cut) {
+            if (cut >= length) continue;
+            char before = name[length - 1 - cut];
+            if (before >= '0' && before <= '9') return length - cut;
+        }
+        return length;
+    }
+
+public:
+    DoorGroups() : roomIds(nullptr), numGroups(0), groupStart(nullptr), doors(nullptr), doorPosition(nullptr),
+                   borrowed(false) {}
+    ~DoorGroups() {
+        delete roomIds;
+        if (borrowed) return;
+        delete[] groupStart;
+        delete[] doors;
+        delete[] doorPosition;
+    }
+
+    // rooms / roomOf hold the explicit room of each node (-1 = none), or are null.
+    void build(const NamePool* names, const NamePool* rooms, const int* roomOf) {
+        int n = names->size();
+        roomIds = new HashTable(16);
+        int* groupOf = new int[n > 0 ? n : 1];
+        numGroups = 0;
+        string key;
+        for (int i = 0; i < n; ++i) {
+            string_view name = names->view(i);
+            if (roomOf != nullptr && roomOf[i] != -1) {
+                key.assign(rooms->c_str(roomOf[i]), rooms->length(roomOf[i]));
+            } else {
+                key.assign(name.data(), derivedRoomLength(name));
+            }
+            if (key == name) {
+                groupOf[i] = numGroups++; // a room of its own, found by its node name
+                continue;
+            }
+            int group = roomIds->get(key.c_str());
+            if (group == -1) {
+                group = numGroups++;
+                roomIds->insert(key.c_str(), group);
+            }
+            groupOf[i] = group;
+        }
+        groupStart = new int[numGroups + 1];
+        for (int g = 0; g <= numGroups; ++g) groupStart[g] = 0;
+        for (int i = 0; i < n; ++i) groupStart[groupOf[i] + 1]++;
+        for (int g = 0; g < numGroups; ++g) groupStart[g + 1] += groupStart[g];
+        doors = new int[n > 0 ? n : 1];
+        doorPosition = new int[n > 0 ? n : 1];
+        int* fill = new int[numGroups > 0 ? numGroups : 1];
+        for (int g = 0; g < numGroups; ++g) fill[g] = groupStart[g];
+        for (int i = 0; i < n; ++i) {
+            doorPosition[i] = fill[groupOf[i]]++;
+            doors[doorPosition[i]] = i;
+        }
+        delete[] fill;
+        delete[] groupOf;
+    }
+
+    // Doors of a room ID, or 0 if no group has that ID.
+    int roomDoors(const char* room, const int*& roomDoorList) const {
+        int group = roomIds->get(room);
+        if (group == -1) return 0;
+        roomDoorList = doors + groupStart[group];
+        return groupStart[group + 1] - groupStart[group];
+    }
+    // A single node as a door list of length 1.
+    const int* nodeAsDoor(int node) const {
+        return doors + doorPosition[node];
+    }
+    int groupCount() const {
+        return numGroups;
+    }
+    int roomCount() const {
+        return roomIds->size();
+    }
+    // room IDs in group-table order (only rooms that are not node names)
+    const NamePool* roomNames() const {
+        return roomIds->keyNames();
+    }
+
+    long long memoryBytes() const {
+        int n = groupStart[numGroups];
+        return roomIds->memoryBytes() + (long long)(numGroups + 1) * sizeof(int) + 2LL * n * sizeof(int);
+    }
+
+    // The room table is written as its names and groups and rebuilt on read:
+    // one insert per room, no allocation per entry.
+    void writeSnapshot(SnapshotWriter& out) const {
+        int n = groupStart[numGroups];
+        out.write("DOOR_GROUP_START", groupStart, numGroups + 1);
+        out.write("DOORS", doors, n);
+        out.write("DOOR_POSITION", doorPosition, n);
+        const NamePool* rooms = roomIds->keyNames();
+        int* roomGroup = new int[rooms->size() > 0 ? rooms->size() : 1];
+        for (int r = 0; r < rooms->size(); ++r) roomGroup[r] = roomIds->get(rooms->c_str(r));
+        rooms->writeSnapshot(out, "ROOM_NAME");
+        out.write("ROOM_GROUP", roomGroup, rooms->size());
+        delete[] roomGroup;
+    }
+    bool readSnapshot(SnapshotReader& in, int n) {
+        long long starts = 0;
+        int* mappedStarts = in.takeAny<int>(starts);
+        int* mappedDoors = in.take<int>(n);
+        int* mappedPositions = in.take<int>(n);
+        NamePool rooms(0, 0);
+        if (!in.ok || starts < 1 || !rooms.readSnapshot(in)) return false;
+        int* roomGroup = in.take<int>(rooms.size());
+        if (!in.ok || mappedStarts[0] != 0 || mappedStarts[starts - 1] != n) return false;
+        for (long long g = 0; g + 1 < starts; ++g) {
+            if (mappedStarts[g] > mappedStarts[g + 1]) return false;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (mappedPositions[i] < 0 || mappedPositions[i] >= n || mappedDoors[mappedPositions[i]] != i) return false;
+        }
+        for (int r = 0; r < rooms.size(); ++r) {
+            if (roomGroup[r] < 0 || roomGroup[r] >= starts - 1) return false;
+        }
+        delete roomIds;
+        roomIds = new HashTable(rooms.size() * 2);
+        for (int r = 0; r < rooms.size(); ++r) roomIds->insert(rooms.c_str(r), roomGroup[r]);
+        if (!borrowed) {
+            delete[] groupStart;
+            delete[] doors;
+            delete[] doorPosition;
+        }
+        numGroups = (int)starts - 1;
+        groupStart = mappedStarts;
+        doors = mappedDoors;
+        doorPosition = mappedPositions;
+        borrowed = true;
+        return true;
+    }
+};
+
+// LSD radix sort of (key, value) pairs by key, 8 bits per pass, stable.
+// After the four passes the result is back in the caller's arrays.
+void radixSortByKey(unsigned int* keys, int* values, int n) {
+    unsigned int* keyBuffer = new unsigned int[n > 0 ? n : 1];
+    int* valueBuffer = new int[n > 0 ? n : 1];
+    int counts[257];
+    for (int shift = 0; shift < 32; shift += 8) {
+        for (int b = 0; b <= 256; ++b) counts[b] = 0;
+        for (int i = 0; i < n; ++i) counts[((keys[i] >> shift) & 255) + 1]++;
+        for (int b = 0; b < 256; ++b) counts[b + 1] += counts[b];
+        for (int i = 0; i < n; ++i) {
+            int to = counts[(keys[i] >> shift) & 255]++;
+            keyBuffer[to] = keys[i];
+            valueBuffer[to] = values[i];
+        }
+        unsigned int* swapKeys = keys;
+        keys = keyBuffer;
+        keyBuffer = swapKeys;
+        int* swapValues = values;
+        values = valueBuffer;
+        valueBuffer = swapValues;
+    }
+    delete[] keyBuffer;
+    delete[] valueBuffer;
+}
+
+// Typo-tolerant name lookup for the start/end prompt. Entries are all node
+// names plus the door-group room IDs. Every entry is folded (ASCII lowercase,
+// separators ' ', '-', '_', '.', '/' dropped) and indexed by the hashes of its
+// deletion neighbourhood: the folded key with up to FUZZY_MAX_EDITS characters
+// removed. Two keys within that many edits (insertions, deletions,
+// substitutions, adjacent swaps) share a deletion variant, so a query only
+// hashes its own few variants, binary-searches each in one sorted array and
+// verifies the candidates with a bounded edit distance. Prefix completions of
+// the folded query come from a NamePrefixIndex over the folded keys.
+#ifndef FUZZY_MAX_EDITS
+#define FUZZY_MAX_EDITS 1
+#endif
+
+struct FuzzyMatch {
+    int entry;
+    int edits;  // edit distance between the folded query and the folded entry
+    int extra;  // characters beyond the query: length difference, or completion length
+};
+
+class FuzzyNameIndex {
+private:
+    static const int MAX_KEY = 64; // longer folded keys are only matched by prefix
+    const NamePool* nodeNames;
+    const NamePool* roomNames; // may be null
+    int numEntries;            // node names, then the room IDs in roomEntry
+    int* roomEntry;            // room ID of every entry past the node names
+    NamePool* folded;          // folded key of every entry
+    NamePrefixIndex* completions;
+    unsigned int* variantHash; // sorted deletion-variant hashes
+    int* variantEntry;         // entry of each variant
+    int numVariants;
+
+    static bool isSeparator(char c) {
+        return c == ' ' || c == '-' || c == '_' || c == '.' || c == '/';
+    }
+    static int fold(const char* text, int length, char* out, int capacity) {
+        int n = 0;
+        for (int i = 0; i < length && n < capacity; ++i) {
+            char c = text[i];
+            if (isSeparator(c)) continue;
+            out[n++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+        }
+        return n;
+    }
+    static unsigned int hashBytes(const char* key, int length) {
+        unsigned int h = 2166136261u;
+        for (int i = 0; i < length; ++i) {
+            h ^= (unsigned char)key[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+    // Hashes of 'key' with 0..edits characters deleted, appended to 'out'
+    // without duplicates. 'out' holds at least variantBound(length) values.
+    static void deletionVariants(const char* key, int length, int edits, unsigned int* out, int& count) {
+        unsigned int h = hashBytes(key, length);
+        for (int i = 0; i < count; ++i) {
+            if (out[i] == h) return; // this string was already expanded
+        }
+        out[count++] = h;
+        if (edits == 0 || length == 0) return;
+        char shorter[MAX_KEY];
+        for (int skip = 0; skip < length; ++skip) {
+            memcpy(shorter, key, skip);
+            memcpy(shorter + skip, key + skip + 1, length - skip - 1);
+            deletionVariants(shorter, length - 1, edits - 1, out, count);
+        }
+    }
+    static int variantBound(int length) {
+        int bound = 1, level = 1;
+        for (int e = 0; e < FUZZY_MAX_EDITS; ++e) {
+            level *= length - e > 0 ? length - e : 0;
+            bound += level;
+        }
+        return bound;
+    }
+    // Optimal string alignment distance, or limit + 1 once it exceeds limit.
+    static int boundedDistance(const char* a, int n, const char* b, int m, int limit) {
+        if (n - m > limit || m - n > limit) return limit + 1;
+        int rows[3][MAX_KEY + 1];
+        int* before = rows[0];
+        int* previous = rows[1];
+        int* current = rows[2];
+        for (int j = 0; j <= m; ++j) previous[j] = j;
+        for (int i = 1; i <= n; ++i) {
+            current[0] = i;
+            int best = current[0];
+            for (int j = 1; j <= m; ++j) {
+                int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+                int d = previous[j - 1] + cost;
+                if (previous[j] + 1 < d) d = previous[j] + 1;
+                if (current[j - 1] + 1 < d) d = current[j - 1] + 1;
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && before[j - 2] + 1 < d) {
+                    d = before[j - 2] + 1;
+                }
+                current[j] = d;
+                if (d < best) best = d;
+            }
+            if (best > limit) return limit + 1;
+            int* recycled = before;
+            before = previous;
+            previous = current;
+            current = recycled;
+        }
+        return previous[m] <= limit ? previous[m] : limit + 1;
+    }
+    // keeps 'matches' sorted by (edits, extra, name) and at most 'limit' long
+    void consider(FuzzyMatch* matches, int& count, int limit, int entry, int edits, int extra) const {
+        for (int i = 0; i < count; ++i) {
+            if (matches[i].entry != entry) continue;
+            if (matches[i].edits < edits || (matches[i].edits == edits && matches[i].extra <= extra)) return;
+            // found again with a better rank: drop the old match
+            for (int j = i; j + 1 < count; ++j) matches[j] = matches[j + 1];
+            count--;
+            break;
+        }
+        int at = count;
+        while (at > 0) {
+            const FuzzyMatch& other = matches[at - 1];
+            bool before = edits != other.edits ? edits < other.edits
+                        : extra != other.extra ? extra < other.extra
+                        : name(entry) < name(other.entry);
+            if (!before) break;
+            at--;
+        }
+        if (at >= limit) return;
+        int last = count < limit ? count : limit - 1;
+        for (int i = last; i > at; --i) matches[i] = matches[i - 1];
+        matches[at].entry = entry;
+        matches[at].edits = edits;
+        matches[at].extra = extra;
+        if (count < limit) count++;
+    }
+
+public:
+    double buildMillis;
+
+    FuzzyNameIndex() : nodeNames(nullptr), roomNames(nullptr), numEntries(0), roomEntry(nullptr), folded(nullptr), completions(nullptr),
+        variantHash(nullptr), variantEntry(nullptr), numVariants(0), buildMillis(0.0) {}
+    ~FuzzyNameIndex() {
+        delete[] roomEntry;
+        delete folded;
+        delete completions;
+        delete[] variantHash;
+        delete[] variantEntry;
+    }
+
+    void build(const NamePool* nodes, const NamePool* rooms) {
+        auto startTime = chrono::steady_clock::now();
+        nodeNames = nodes;
+        roomNames = rooms;
+        int numNodes = nodes->size();
+        int numRooms = rooms != nullptr ? rooms->size() : 0;
+        folded = new NamePool(numNodes + numRooms, 0);
+        roomEntry = new int[numRooms > 0 ? numRooms : 1];
+        char key[MAX_KEY + 1];
+        long long total = 0;
+        // a room ID that folds to a node name (room H14 next to node H14)
+        // would only repeat that node, so it gets no entry of its own
+        HashTable nodeKeys(numRooms > 0 ? numNodes * 2 : 16);
+        for (int v = 0; v < numNodes; ++v) {
+            string_view text = nodes->view(v);
+            int length = fold(text.data(), (int)text.size(), key, MAX_KEY);
+            folded->intern(key, length);
+            total += variantBound(length);
+            key[length] = '\0';
+            if (numRooms > 0) nodeKeys.insert(key, v);
+        }
+        numEntries = numNodes;
+        for (int r = 0; r < numRooms; ++r) {
+            string_view text = rooms->view(r);
+            int length = fold(text.data(), (int)text.size(), key, MAX_KEY);
+            key[length] = '\0';
+            if (nodeKeys.get(key) != -1) continue;
+            folded->intern(key, length);
+            total += variantBound(length);
+            roomEntry[numEntries++ - numNodes] = r;
+        }
+        variantHash = new unsigned int[total > 0 ? total : 1];
+        variantEntry = new int[total > 0 ? total : 1];
+        numVariants = 0;
+        for (int e = 0; e < numEntries; ++e) {
+            int added = 0;
+            deletionVariants(folded->c_str(e), folded->length(e), FUZZY_MAX_EDITS, variantHash + numVariants, added);
+            for (int i = 0; i < added; ++i) variantEntry[numVariants + i] = e;
+            numVariants += added;
+        }
+        radixSortByKey(variantHash, variantEntry, numVariants);
+        completions = new NamePrefixIndex();
+        completions->build(folded);
+        buildMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    int entryCount() const {
+        return numEntries;
+    }
+    // original spelling of an entry: node names first, then room IDs
+    string_view name(int entry) const {
+        int nodes = nodeNames->size();
+        return entry < nodes ? nodeNames->view(entry) : roomNames->view(roomEntry[entry - nodes]);
+    }
+
+    // Up to 'limit' entries closest to 'typed', best first: exact folded
+    // matches, then completions of the folded text, then typos by edit distance.
+    int suggest(const char* typed, int limit, FuzzyMatch* matches) const {
+        int count = 0;
+        if (limit <= 0) return 0;
+        char query[MAX_KEY];
+        int length = fold(typed, strlen(typed), query, MAX_KEY);
+        unsigned int variants[1 + MAX_KEY + MAX_KEY * MAX_KEY];
+        int numQueryVariants = 0;
+        if (variantBound(length) <= (int)(sizeof(variants) / sizeof(variants[0]))) {
+            deletionVariants(query, length, FUZZY_MAX_EDITS, variants, numQueryVariants);
+        }
+        for (int v = 0; v < numQueryVariants; ++v) {
+            int lo = 0, hi = numVariants;
+            while (lo < hi) {
+                int mid = lo + (hi - lo) / 2;
+                if (variantHash[mid] < variants[v]) lo = mid + 1;
+                else hi = mid;
+            }
+            for (int i = lo; i < numVariants && variantHash[i] == variants[v]; ++i) {
+                int entry = variantEntry[i];
+                int edits = boundedDistance(query, length, folded->c_str(entry), folded->length(entry), FUZZY_MAX_EDITS);
+                if (edits > FUZZY_MAX_EDITS) continue;
+                int extra = folded->length(entry) - length;
+                consider(matches, count, limit, entry, edits, extra < 0 ? -extra : extra);
+            }
+        }
+        // completions, shortest first; edits 0 ranks them ahead of typos
+        string_view prefix(query, length);
+        int taken = 0;
+        for (int extra = 0; extra <= MAX_KEY && taken < limit; ++extra) {
+            int begin, end;
+            completions->findRange(prefix, length + extra, begin, end);
+            for (int p = begin; p < end && taken < limit; ++p, ++taken) {
+                consider(matches, count, limit, completions->at(p), 0, extra);
+            }
+        }
+        return count;
+    }
+
+    long long memoryBytes() const {
+        return folded->memoryBytes() + completions->memoryBytes() +
+               (long long)numVariants * (sizeof(unsigned int) + sizeof(int));
+    }
+};
+
+// Separate chaining hash table, the original node map. Kept as the
+// baseline for --bench hash.
+struct ChainedHashNode {
+    char key[50];
+    int value;
+    ChainedHashNode* next;
+    ChainedHashNode() : value(0), next(nullptr) { key[0] = '\0'; }
+};
+
+class ChainedHashTable {
+private:
+    ChainedHashNode** buckets; // pointer to an array of pointers 
     int numBuckets;
     // hash function 
     unsigned long hash(const char* str) {
@@ -29,17 +1284,17 @@ private:
         return hash % numBuckets;
     }
 public:
-    HashTable(int size) : numBuckets(size) {
-        buckets = new HashNode*[numBuckets];
+    ChainedHashTable(int size) : numBuckets(size) {
+        buckets = new ChainedHashNode*[numBuckets];
         for (int i = 0; i < numBuckets; ++i) {
             buckets[i] = nullptr;
         }
     }
-    ~HashTable() {
+    ~ChainedHashTable() {
         for (int i = 0; i < numBuckets; ++i) {
-            HashNode* entry = buckets[i];
+            ChainedHashNode* entry = buckets[i];
             while (entry != nullptr) {
-                HashNode* prev = entry;
+                ChainedHashNode* prev = entry;
                 entry = entry->next;
                 delete prev;
             }
@@ -48,7 +1303,7 @@ public:
     }
     void insert(const char* key, int value) {
         unsigned long bucketIndex = hash(key);
-        HashNode* entry = buckets[bucketIndex];
+        ChainedHashNode* entry = buckets[bucketIndex];
         while(entry != nullptr) {
             if(strcmp(entry->key, key) == 0) {
                 entry->value = value;
@@ -56,7 +1311,7 @@ public:
             }
             entry = entry->next;
         }
-        HashNode* newNode = new HashNode();
+        ChainedHashNode* newNode = new ChainedHashNode();
         strcpy(newNode->key, key);
         newNode->value = value;
         newNode->next = buckets[bucketIndex];
@@ -64,7 +1319,7 @@ public:
     }
     int get(const char* key) {
         unsigned long bucketIndex = hash(key);
-        HashNode* entry = buckets[bucketIndex];
+        ChainedHashNode* entry = buckets[bucketIndex];
         while (entry != nullptr) {
             if (strcmp(entry->key, key) == 0) {
                 return entry->value;
@@ -81,59 +1336,103 @@ struct HeapNode {
     int distance;
 };
 
+// Heap arity, override with -DHEAP_ARITY=2 (binary heap), 8, ...
+#ifndef HEAP_ARITY
+#define HEAP_ARITY 4
+#endif
+
+// Indexed d-ary min heap. Every node index appears at most once; position[]
+// maps a node to its heap slot, so decreaseKey works in place and memory is
+// O(V) instead of one entry per relaxation.
 class MinPriorityQueue {
 private:
-    HeapNode* heapArray; // dynamic array
-    int capacity;
+    static const int ARITY = HEAP_ARITY;
+    HeapNode* heapArray; // dynamic array, at most numNodes entries
+    int* position;       // slot of each node in heapArray, -1 when absent
+    int numNodes;
     int size;
-    int parent(int i) { return (i - 1) / 2; }
-    int left(int i) { return (2 * i + 1); }
-    int right(int i) { return (2 * i + 2); }
-    void swapNodes(int i, int j) {
-        HeapNode temp = heapArray[i];
-        heapArray[i] = heapArray[j];
-        heapArray[j] = temp;
+    int parent(int i) { return (i - 1) / ARITY; }
+    int child(int i, int k) { return ARITY * i + 1 + k; }
+    void place(int i, HeapNode node) {
+        heapArray[i] = node;
+        position[node.nodeIndex] = i;
     }
+    // both moves hold the node aside and shift the others, one write per level
     void HpDown(int i) {
-        int l = left(i);
-        int r = right(i);
-        int smallest = i;
-        if (l < size && heapArray[l].distance < heapArray[smallest].distance) {
-            smallest = l;
-        }
-        if (r < size && heapArray[r].distance < heapArray[smallest].distance) {
-            smallest = r;
-        }
-        if (smallest != i) {
-            swapNodes(i, smallest);
-            HpDown(smallest);
+        HeapNode moving = heapArray[i];
+        while (true) {
+            int first = child(i, 0);
+            if (first >= size) break;
+            int last = first + ARITY < size ? first + ARITY : size;
+            int smallest = first;
+            for (int c = first + 1; c < last; ++c) {
+                if (heapArray[c].distance < heapArray[smallest].distance) smallest = c;
+            }
+            if (heapArray[smallest].distance >= moving.distance) break;
+            place(i, heapArray[smallest]);
+            i = smallest;
         }
+        place(i, moving);
     }
     void HpUp(int i) {
-        while (i != 0 && heapArray[i].distance < heapArray[parent(i)].distance) {
-            swapNodes(i, parent(i));
+        HeapNode moving = heapArray[i];
+        while (i != 0 && moving.distance < heapArray[parent(i)].distance) {
+            place(i, heapArray[parent(i)]);
             i = parent(i);
         }
+        place(i, moving);
     }
 public:
-    MinPriorityQueue(int cap) : capacity(cap), size(0) {
-        heapArray = new HeapNode[capacity];
+    MinPriorityQueue(int nodes) : numNodes(nodes), size(0) {
+        heapArray = new HeapNode[numNodes > 0 ? numNodes : 1];
+        position = new int[numNodes > 0 ? numNodes : 1];
+        for (int i = 0; i < numNodes; ++i) {
+            position[i] = -1;
+        }
     }
     ~MinPriorityQueue() {
         delete[] heapArray;
+        delete[] position;
     }
     bool isEmpty() {
         return size == 0;
     }
+    bool contains(int nodeIndex) {
+        return position[nodeIndex] != -1;
+    }
+    // smallest key in the queue without removing it (INF when empty)
+    int minDistance() {
+        return size == 0 ? 2147483647 : heapArray[0].distance;
+    }
+    // empties the queue in O(size), so it can be reused between searches
+    void clear() {
+        for (int i = 0; i < size; ++i) {
+            position[heapArray[i].nodeIndex] = -1;
+        }
+        size = 0;
+    }
+    // Inserts the node, or moves it to the new key if it is already queued
     void insert(int nodeIndex, int distance) {
-        if (size == capacity) {
-            cout << "Priority queue is full!" << endl;
+        int i = position[nodeIndex];
+        if (i != -1) {
+            int old = heapArray[i].distance;
+            heapArray[i].distance = distance;
+            if (distance < old) HpUp(i);
+            else HpDown(i);
             return;
         }
+        heapArray[size].nodeIndex = nodeIndex;
+        heapArray[size].distance = distance;
+        position[nodeIndex] = size;
         size++;
-        int i = size - 1;
-        heapArray[i].nodeIndex = nodeIndex;
-        heapArray[i].distance = distance;
+        HpUp(size - 1);
+    }
+    void decreaseKey(int nodeIndex, int newDistance) {
+        int i = position[nodeIndex];
+        if (i == -1 || newDistance >= heapArray[i].distance) {
+            return;
+        }
+        heapArray[i].distance = newDistance;
         HpUp(i);
     }
     HeapNode extractMin() {
@@ -141,330 +1440,4328 @@ public:
             return {-1, -1};
         }
         HeapNode root = heapArray[0];
-        heapArray[0] = heapArray[size - 1];
+        position[root.nodeIndex] = -1;
         size--;
-        HpDown(0);
+        if (size > 0) {
+            heapArray[0] = heapArray[size];
+            HpDown(0);
+        }
         return root;
     }
 };
 
-// Stack for paths construction
-struct StackNode {
-    int nodeIndex;
-    StackNode* next;
+// Monotone integer priority queues. Dijkstra only ever extracts
+// non-decreasing integer keys, so these can replace the comparison heap.
+// They keep stale duplicates instead of decreasing keys; the caller skips an
+// extracted entry whose key is larger than the node's current distance.
+// Shared interface with MinPriorityQueue: insert, extractMin, isEmpty, clear.
+
+// growable array of queue entries, used as one bucket
+struct HeapNodeBucket {
+    HeapNode* items;
+    int size;
+    int capacity;
+    HeapNodeBucket() : items(nullptr), size(0), capacity(0) {}
+    ~HeapNodeBucket() {
+        delete[] items;
+    }
+    void push(int nodeIndex, int distance) {
+        if (size == capacity) {
+            capacity = capacity == 0 ? 8 : capacity * 2;
+            HeapNode* grown = new HeapNode[capacity];
+            for (int i = 0; i < size; ++i) grown[i] = items[i];
+            delete[] items;
+            items = grown;
+        }
+        items[size].nodeIndex = nodeIndex;
+        items[size].distance = distance;
+        size++;
+    }
+};
+
+// Radix heap: bucket i holds keys whose highest bit differing from the last
+// extracted key is bit i-1 (bucket 0 holds keys equal to it). Each entry moves
+// down at most 32 times, so extraction is O(log C) amortized.
+class RadixHeap {
+private:
+    static const int NUM_BUCKETS = 33;
+    HeapNodeBucket buckets[NUM_BUCKETS];
+    unsigned int last; // last extracted key
+    int size;
+    int bucketFor(unsigned int key) {
+        unsigned int diff = key ^ last;
+        if (diff == 0) return 0;
+#if defined(__GNUC__)
+        return 32 - __builtin_clz(diff);
+#else
+        int bits = 0;
+        while (diff != 0) {
+            bits++;
+            diff >>= 1;
+        }
+        return bits;
+#endif
+    }
+public:
+    RadixHeap() : last(0), size(0) {}
+    bool isEmpty() {
+        return size == 0;
+    }
+    void clear() {
+        for (int i = 0; i < NUM_BUCKETS; ++i) buckets[i].size = 0;
+        last = 0;
+        size = 0;
+    }
+    void insert(int nodeIndex, int distance) {
+        buckets[bucketFor((unsigned int)distance)].push(nodeIndex, distance);
+        size++;
+    }
+    HeapNode extractMin() {
+        if (isEmpty()) {
+            return {-1, -1};
+        }
+        if (buckets[0].size == 0) {
+            // redistribute the first non-empty bucket around its minimum
+            int i = 1;
+            while (buckets[i].size == 0) i++;
+            HeapNodeBucket& source = buckets[i];
+            unsigned int smallest = (unsigned int)source.items[0].distance;
+            for (int k = 1; k < source.size; ++k) {
+                if ((unsigned int)source.items[k].distance < smallest) smallest = source.items[k].distance;
+            }
+            last = smallest;
+            for (int k = 0; k < source.size; ++k) {
+                HeapNode item = source.items[k];
+                buckets[bucketFor((unsigned int)item.distance)].push(item.nodeIndex, item.distance);
+            }
+            source.size = 0;
+        }
+        size--;
+        return buckets[0].items[--buckets[0].size];
+    }
+};
+
+// Dial's bucket queue: with edge weights at most C every queued key lies in
+// [last, last + C], so a circular array of C + 1 buckets indexed by key
+// modulo C + 1 is enough. Extraction scans forward from the current bucket.
+// Only for small C (see fits()); clear() resets just the buckets used since
+// the last clear.
+class DialQueue {
+private:
+    HeapNodeBucket* buckets;
+    int numBuckets;
+    int current; // bucket of the last extracted key
+    int size;
+    int* used;   // buckets filled since the last clear()
+    int numUsed;
+    bool* isUsed;
+public:
+    static const int MAX_BUCKETS = 1 << 20;
+    // whether C + 1 buckets stay within MAX_BUCKETS
+    static bool fits(int maxEdgeWeight) {
+        return maxEdgeWeight >= 0 && maxEdgeWeight < MAX_BUCKETS;
+    }
+
+    DialQueue(int maxEdgeWeight) : numBuckets(maxEdgeWeight + 1), current(0), size(0), numUsed(0) {
+        buckets = new HeapNodeBucket[numBuckets];
+        used = new int[numBuckets];
+        isUsed = new bool[numBuckets];
+        for (int i = 0; i < numBuckets; ++i) isUsed[i] = false;
+    }
+    ~DialQueue() {
+        delete[] buckets;
+        delete[] used;
+        delete[] isUsed;
+    }
+    bool isEmpty() {
+        return size == 0;
+    }
+    void clear() {
+        for (int i = 0; i < numUsed; ++i) {
+            buckets[used[i]].size = 0;
+            isUsed[used[i]] = false;
+        }
+        numUsed = 0;
+        current = 0;
+        size = 0;
+    }
+    void insert(int nodeIndex, int distance) {
+        int bucket = distance % numBuckets;
+        if (!isUsed[bucket]) {
+            isUsed[bucket] = true;
+            used[numUsed++] = bucket;
+        }
+        buckets[bucket].push(nodeIndex, distance);
+        size++;
+    }
+    HeapNode extractMin() {
+        if (isEmpty()) {
+            return {-1, -1};
+        }
+        while (buckets[current].size == 0) {
+            current = current + 1 == numBuckets ? 0 : current + 1;
+        }
+        size--;
+        return buckets[current].items[--buckets[current].size];
+    }
+};
+
+// Queue backend for dijkstra(); the default can be chosen at build time with
+// -DDIJKSTRA_QUEUE=QUEUE_RADIX (or QUEUE_DIAL) and at run time with --queue.
+enum QueueBackend {
+    QUEUE_HEAP,
+    QUEUE_RADIX,
+    QUEUE_DIAL
+};
+
+#ifndef DIJKSTRA_QUEUE
+#define DIJKSTRA_QUEUE QUEUE_HEAP
+#endif
+
+const char* queueName(QueueBackend backend) {
+    switch (backend) {
+        case QUEUE_RADIX: return "radix";
+        case QUEUE_DIAL: return "dial";
+        default: return "heap";
+    }
+}
+
+bool parseQueue(const char* name, QueueBackend& backend) {
+    if (strcmp(name, "heap") == 0) { backend = QUEUE_HEAP; return true; }
+    if (strcmp(name, "radix") == 0) { backend = QUEUE_RADIX; return true; }
+    if (strcmp(name, "dial") == 0) { backend = QUEUE_DIAL; return true; }
+    return false;
+}
+
+// Dial's queue needs one bucket per weight value; above DialQueue::MAX_BUCKETS
+// the radix heap, which is also monotone, runs instead.
+QueueBackend effectiveQueue(QueueBackend backend, int maxEdgeWeight) {
+    if (backend == QUEUE_DIAL && !DialQueue::fits(maxEdgeWeight)) return QUEUE_RADIX;
+    return backend;
+}
+
+// Stack for paths construction
+struct StackNode {
+    int nodeIndex;
+    StackNode* next;
+};
+
+class PathStack {
+private:
+    StackNode* top;
+public:
+    PathStack() : top(nullptr) {}
+    ~PathStack() {
+        while (!isEmpty()) {
+            pop();
+        }
+    }
+    bool isEmpty() {
+        return top == nullptr;
+    }
+    void push(int nodeIndex) {
+        StackNode* newNode = new StackNode();
+        newNode->nodeIndex = nodeIndex;
+        newNode->next = top;
+        top = newNode;
+    }
+    int pop() {
+        if (isEmpty()) {
+            return -1;
+        }
+        StackNode* temp = top;
+        int nodeIndex = temp->nodeIndex;
+        top = top->next;
+        delete temp;
+        return nodeIndex;
+    }
+};
+
+
+// graph implementation
+struct AdjListNode {
+    int destIndex; // index of the destination node
+    int weight; // weight of the edge
+    AdjListNode* next; // pointer to the next node
+    AdjListNode() : destIndex(-1), weight(0), next(nullptr) {}
+};
+
+// Frozen compressed sparse row adjacency: the edges of node u are
+// targets/weights[begin[u] .. end[u]), all in contiguous arrays. The outgoing
+// and incoming views share one edge block per node, see ManualGraph::freeze().
+// After ManualGraph::packEdges() the entries are 32-bit words instead: the
+// low targetBits hold the target, the high bits index weightTable.
+struct EdgeArrays {
+    const int* begin;
+    const int* end;
+    const int* targets;
+    const int* weights;
+    const unsigned* packed;
+    const int* weightTable;
+    int targetBits;
+    unsigned targetMask;
+    EdgeArrays() : begin(nullptr), end(nullptr), targets(nullptr), weights(nullptr), packed(nullptr),
+                   weightTable(nullptr), targetBits(0), targetMask(0) {}
+    int target(int e) const { return packed != nullptr ? (int)(packed[e] & targetMask) : targets[e]; }
+    int weight(int e) const { return packed != nullptr ? weightTable[packed[e] >> targetBits] : weights[e]; }
+};
+
+// node "type" field from the JSON
+enum NodeType {
+    NODE_OTHER,
+    NODE_HALLWAY,
+    NODE_ROOM,
+    NODE_CLASSROOM,
+    NODE_STAIRS,
+    NODE_ELEVATOR,
+    NODE_ENTRANCE
+};
+
+NodeType parseNodeType(const char* type) {
+    if (strcmp(type, "hallway") == 0) return NODE_HALLWAY;
+    if (strcmp(type, "room") == 0) return NODE_ROOM;
+    if (strcmp(type, "classroom") == 0) return NODE_CLASSROOM;
+    if (strcmp(type, "stairs") == 0) return NODE_STAIRS;
+    if (strcmp(type, "elevator") == 0) return NODE_ELEVATOR;
+    if (strcmp(type, "entrance") == 0) return NODE_ENTRANCE;
+    return NODE_OTHER;
+}
+
+// Node numbering applied by freeze(). Input keeps the JSON order; the others
+// renumber nodes so that neighbours sit close together in memory.
+enum NodeOrder {
+    ORDER_INPUT,
+    ORDER_HILBERT, // position along a Hilbert curve over x/y
+    ORDER_BFS,     // breadth-first order over the undirected graph
+    ORDER_RCM      // reverse Cuthill-McKee
+};
+
+const char* orderName(NodeOrder order) {
+    switch (order) {
+        case ORDER_HILBERT: return "hilbert";
+        case ORDER_BFS: return "bfs";
+        case ORDER_RCM: return "rcm";
+        default: return "input";
+    }
+}
+
+bool parseOrder(const char* name, NodeOrder& order) {
+    if (strcmp(name, "input") == 0) { order = ORDER_INPUT; return true; }
+    if (strcmp(name, "hilbert") == 0) { order = ORDER_HILBERT; return true; }
+    if (strcmp(name, "bfs") == 0) { order = ORDER_BFS; return true; }
+    if (strcmp(name, "rcm") == 0) { order = ORDER_RCM; return true; }
+    return false;
+}
+
+// Distance along a Hilbert curve filling a 65536 x 65536 grid
+unsigned int hilbertIndex(unsigned int x, unsigned int y) {
+    unsigned int d = 0;
+    for (unsigned int s = 1u << 15; s > 0; s >>= 1) {
+        unsigned int rx = (x & s) > 0;
+        unsigned int ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - (x & (s - 1));
+                y = s - 1 - (y & (s - 1));
+            }
+            unsigned int t = x;
+            x = y;
+            y = t;
+        }
+        x &= s - 1;
+        y &= s - 1;
+    }
+    return d;
+}
+
+class ContractionHierarchy;
+class LandmarkTable;
+class DistanceTable;
+class HubLabels;
+
+class ManualGraph {
+public:
+    int numVertices;
+    AdjListNode** adjLists; // edges while loading, released by freeze()
+    AdjListNode** reverseAdjLists; // incoming edges, for backward searches
+    EdgeArrays outEdges; // CSR view built by freeze(), used by every search engine
+    EdgeArrays inEdges;  // reversed edges, a second view of the same block
+    // Edge block of node u, built by freeze(): [in-only | undirected | out-only]
+    // from blockStart[u] to blockStart[u + 1]. A mirrored pair u->v, v->u with
+    // equal weight is one undirected entry at u and one at v; the remaining
+    // one-way edges form a directed overlay. outEdges reads the undirected
+    // and out-only parts, inEdges the in-only and undirected parts.
+    int* blockStart;
+    int* undirectedStart;
+    int* outOnlyStart;
+    int* edgeTargets;
+    int* edgeWeights;
+    int numUndirected; // mirrored pairs stored once
+    int numOneWay;
+    unsigned* packedEdges; // set by packEdges(), replaces edgeTargets/edgeWeights
+    int* weightTable;      // distinct edge weights, ascending
+    int numWeightClasses;
+    bool frozen;
+    HashTable* nodeMap;
+    NodeIdPerfectHash* idHash; // built by freeze(), answers indexOf() at query time
+    NamePool* names; // node names; name id == node index
+    NamePrefixIndex* prefixIndex; // built by freeze(), used for door lookups
+    DoorGroups* doorGroups; // built by freeze(), rooms to their doors
+    FuzzyNameIndex* fuzzyIndex; // built on first use by fuzzy()
+    NodeOrder nodeOrder; // numbering chosen at freeze()
+    int* externalId; // input (JSON) position of every node, set by freeze()
+    int* internalId; // node index of every input position
+    NamePool* roomNames; // explicit room fields seen while loading, freed by freeze()
+    int* roomOf;         // explicit room of each node, -1 = none
+    int* nodeX; // absolute pixel coordinates from the JSON
+    int* nodeY;
+    unsigned char* nodeType; // NodeType of every node
+    int numEdges;
+    int maxEdgeWeight;
+    double heuristicScale; // weight units per pixel, see computeHeuristicScale()
+    ContractionHierarchy* ch; // built on demand for the ch engine
+    LandmarkTable* landmarks; // built on demand for the alt engine
+    DistanceTable* table; // built on demand for the table engine
+    HubLabels* hubLabels; // built on demand for the hub engine
+    int currentNodeIndex;
+
+    // nameChars: total bytes of all names including terminators, if known,
+    // so the name arena is allocated once
+    ManualGraph(int vertices, int nameChars = 0) : ManualGraph() {
+        numVertices = vertices;
+        adjLists = new AdjListNode*[numVertices];
+        reverseAdjLists = new AdjListNode*[numVertices];
+        names = new NamePool(numVertices, nameChars);
+        nodeMap = new HashTable(numVertices * 2, names);
+        nodeX = new int[numVertices];
+        nodeY = new int[numVertices];
+        nodeType = new unsigned char[numVertices];
+        for (int i = 0; i < numVertices; ++i) {
+            adjLists[i] = nullptr;
+            reverseAdjLists[i] = nullptr;
+            nodeX[i] = 0;
+            nodeY[i] = 0;
+            nodeType[i] = NODE_OTHER;
+        }
+    }
+    ~ManualGraph(); // defined after the preprocessed search structures
+    // room: explicit door group of the node, or null to derive it from the name
+    void addNode(const char* name, int x = 0, int y = 0, NodeType type = NODE_OTHER, const char* room = nullptr) {
+        if (currentNodeIndex < numVertices && nodeMap->get(name) == -1) {
+            nodeMap->insert(name, currentNodeIndex); // interns the name as id currentNodeIndex
+            if (room != nullptr && !frozen) {
+                if (roomNames == nullptr) {
+                    roomNames = new NamePool(16, 0);
+                    roomOf = new int[numVertices];
+                    for (int i = 0; i < numVertices; ++i) roomOf[i] = -1;
+                }
+                roomOf[currentNodeIndex] = roomNames->intern(room, strlen(room));
+            }
+            nodeX[currentNodeIndex] = x;
+            nodeY[currentNodeIndex] = y;
+            nodeType[currentNodeIndex] = type;
+            currentNodeIndex++;
+        }
+    }
+    void addEdge(const char* srcName, const char* destName, int weight) {
+        if (frozen) return;
+        int srcIndex = nodeMap->get(srcName);
+        int destIndex = nodeMap->get(destName);
+        if (srcIndex == -1 || destIndex == -1) {
+            return;
+        }
+        AdjListNode* newNode = new AdjListNode();
+        newNode->destIndex = destIndex;
+        newNode->weight = weight;
+        newNode->next = adjLists[srcIndex];
+        adjLists[srcIndex] = newNode;
+
+        // JSON edges are directed, so keep the mirrored entry for backward searches
+        AdjListNode* reverseNode = new AdjListNode();
+        reverseNode->destIndex = srcIndex;
+        reverseNode->weight = weight;
+        reverseNode->next = reverseAdjLists[destIndex];
+        reverseAdjLists[destIndex] = reverseNode;
+        numEdges++;
+        if (weight > maxEdgeWeight) maxEdgeWeight = weight;
+    }
+    // Typo-tolerant index over node names and room IDs, built on first use.
+    FuzzyNameIndex* fuzzy() {
+        if (fuzzyIndex == nullptr) {
+            fuzzyIndex = new FuzzyNameIndex();
+            fuzzyIndex->build(names, doorGroups != nullptr ? doorGroups->roomNames() : nullptr);
+        }
+        return fuzzyIndex;
+    }
+    // Name of a node; empty for slots never filled by addNode.
+    const char* nameOf(int index) const {
+        return index < names->size() ? names->c_str(index) : "";
+    }
+    // Slots addNode left empty, i.e. nodes dropped for a repeated id.
+    int unnamedNodes() const {
+        return numVertices - names->size();
+    }
+    // Node index for a name, -1 if unknown. Uses the perfect hash once frozen.
+    int indexOf(const char* name) {
+        return idHash != nullptr ? idHash->get(name) : nodeMap->get(name); // a mapped graph has one of them
+    }
+    // entries in the edge block; separate out and in CSR arrays would hold
+    // 2 * numEdges
+    int storedEdgeEntries() const {
+        return blockStart != nullptr ? blockStart[numVertices] : 0;
+    }
+    // bytes of the edge entries (not the per-node offsets)
+    long long edgeBytes() const {
+        long long entries = storedEdgeEntries();
+        if (packedEdges != nullptr) return entries * (long long)sizeof(unsigned) + numWeightClasses * (long long)sizeof(int);
+        return entries * 2 * (long long)sizeof(int);
+    }
+    // Hash of the frozen edge blocks (offsets, targets, weights). Packed and
+    // plain edges hash alike, so precomputed tables survive --edges packed.
+    unsigned long long edgeHash() const {
+        unsigned long long hash = 14695981039346656037ULL;
+        auto mix = [&hash](long long word) {
+            hash = (hash ^ (unsigned long long)word) * 0x100000001b3ULL;
+            hash ^= hash >> 29;
+        };
+        for (int u = 0; u < numVertices; ++u) {
+            mix(blockStart[u + 1]);
+            mix(undirectedStart[u]);
+            mix(outOnlyStart[u]);
+        }
+        int entries = storedEdgeEntries();
+        for (int e = 0; e < entries; ++e) {
+            mix(outEdges.target(e));
+            mix(outEdges.weight(e));
+        }
+        return hash;
+    }
+    // Optional compact format, call after freeze(): every edge entry becomes
+    // one 32-bit word holding the target and the index of its weight in a
+    // table of the distinct weights. Weights stay exact. Returns false and
+    // keeps the plain arrays when targets and weight classes do not fit in
+    // 32 bits together.
+    bool packEdges() {
+        if (!frozen || packedEdges != nullptr) return packedEdges != nullptr;
+        int entries = storedEdgeEntries();
+        int targetBits = 1;
+        while (targetBits < 31 && (1 << targetBits) < numVertices) targetBits++;
+        int classBits = 32 - targetBits;
+
+        // distinct weights: sort a copy and drop duplicates
+        int* sorted = new int[entries > 0 ? entries : 1];
+        for (int e = 0; e < entries; ++e) sorted[e] = edgeWeights[e];
+        int* scratch = new int[entries > 0 ? entries : 1];
+        for (int width = 1; width < entries; width *= 2) {
+            for (int lo = 0; lo < entries; lo += 2 * width) {
+                int mid = lo + width < entries ? lo + width : entries;
+                int hi = lo + 2 * width < entries ? lo + 2 * width : entries;
+                int a = lo, b = mid, k = lo;
+                while (a < mid && b < hi) scratch[k++] = sorted[a] <= sorted[b] ? sorted[a++] : sorted[b++];
+                while (a < mid) scratch[k++] = sorted[a++];
+                while (b < hi) scratch[k++] = sorted[b++];
+            }
+            int* t = sorted;
+            sorted = scratch;
+            scratch = t;
+        }
+        delete[] scratch;
+        int classes = 0;
+        for (int e = 0; e < entries; ++e) {
+            if (classes == 0 || sorted[classes - 1] != sorted[e]) sorted[classes++] = sorted[e];
+        }
+        if ((long long)classes > (1LL << classBits)) {
+            delete[] sorted;
+            return false;
+        }
+        weightTable = new int[classes > 0 ? classes : 1];
+        for (int c = 0; c < classes; ++c) weightTable[c] = sorted[c];
+        delete[] sorted;
+        numWeightClasses = classes;
+
+        packedEdges = new unsigned[entries > 0 ? entries : 1];
+        for (int e = 0; e < entries; ++e) {
+            int lo = 0, hi = classes - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (weightTable[mid] < edgeWeights[e]) lo = mid + 1;
+                else hi = mid;
+            }
+            packedEdges[e] = ((unsigned)lo << targetBits) | (unsigned)edgeTargets[e];
+        }
+        if (!borrowedArrays) {
+            delete[] edgeTargets;
+            delete[] edgeWeights;
+        }
+        edgeTargets = nullptr;
+        edgeWeights = nullptr;
+        EdgeArrays* views[2] = {&outEdges, &inEdges};
+        for (int k = 0; k < 2; ++k) {
+            views[k]->targets = nullptr;
+            views[k]->weights = nullptr;
+            views[k]->packed = packedEdges;
+            views[k]->weightTable = weightTable;
+            views[k]->targetBits = targetBits;
+            views[k]->targetMask = (1u << targetBits) - 1;
+        }
+        return true;
+    }
+    // Binary snapshot of a frozen graph: node attributes, names, the edge
+    // blocks and the lookup structures, laid out so mapSnapshot() can use
+    // every array in place. Written before packEdges(); a packed graph is
+    // packed again after mapping.
+    bool writeSnapshot(const char* filename) const {
+        ofstream out(filename, ios::binary);
+        return out.is_open() && writeSnapshot(out);
+    }
+    bool writeSnapshot(ostream& out) const {
+        long long header[SNAPSHOT_HEADER_WORDS] = {0};
+        out.write((const char*)header, sizeof(header));
+        SnapshotWriter sections(out);
+        if (!writeSections(sections, header)) return false;
+        out.seekp(0);
+        out.write((const char*)header, sizeof(header));
+        return out.good();
+    }
+    // Every section in order, then the header words that describe them.
+    // Also used for the typed arrays of the embedded header.
+    bool writeSections(SnapshotWriter& sections, long long* header) const {
+        // the reader expects one name per node
+        if (!frozen || packedEdges != nullptr || unnamedNodes() != 0) return false;
+        int stored = storedEdgeEntries();
+        names->writeSnapshot(sections, "NODE_NAME");
+        sections.write("NODE_X", nodeX, numVertices);
+        sections.write("NODE_Y", nodeY, numVertices);
+        sections.write("NODE_TYPE", nodeType, numVertices);
+        sections.write("EXTERNAL_ID", externalId, externalId != nullptr ? numVertices : 0);
+        sections.write("INTERNAL_ID", internalId, internalId != nullptr ? numVertices : 0);
+        sections.write("BLOCK_START", blockStart, numVertices + 1);
+        sections.write("UNDIRECTED_START", undirectedStart, numVertices);
+        sections.write("OUT_ONLY_START", outOnlyStart, numVertices);
+        sections.write("EDGE_TARGETS", edgeTargets, stored);
+        sections.write("EDGE_WEIGHTS", edgeWeights, stored);
+        if (idHash != nullptr) idHash->writeSnapshot(sections);
+        else nodeMap->writeSnapshot(sections);
+        prefixIndex->writeSnapshot(sections);
+        doorGroups->writeSnapshot(sections);
+
+        header[0] = SNAPSHOT_MAGIC;
+        header[1] = SNAPSHOT_VERSION;
+        header[2] = sections.payloadBytes;
+        header[3] = (long long)sections.checksum();
+        header[4] = numVertices;
+        header[5] = numEdges;
+        header[6] = maxEdgeWeight;
+        header[7] = nodeOrder;
+        header[8] = numUndirected;
+        header[9] = numOneWay;
+        header[10] = idHash != nullptr;
+        memcpy(&header[11], &heuristicScale, sizeof(double));
+        return true;
+    }
+    // Maps a snapshot read-only and points the graph at it: no parsing and no
+    // allocation per node or edge. The header, checksum and array sizes are
+    // checked; on failure returns null with the reason in 'error'.
+    static ManualGraph* mapSnapshot(const char* filename, string& error) {
+        MappedFile file;
+        if (!file.open(filename)) {
+            error = "could not open or map file";
+            return nullptr;
+        }
+        long long header[SNAPSHOT_HEADER_WORDS];
+        if (file.size < (long long)sizeof(header)) {
+            error = "file too small";
+            return nullptr;
+        }
+        memcpy(header, file.data, sizeof(header));
+        char* payload = const_cast<char*>(file.data) + sizeof(header); // mapped read-only, never written
+        char* stop = const_cast<char*>(file.data) + file.size;
+        if (!checkHeader(header, error)) return nullptr;
+        if (header[2] != file.size - (long long)sizeof(header)) {
+            error = "truncated snapshot";
+            return nullptr;
+        }
+        if ((unsigned long long)header[3] != SnapshotReader::checksum(payload, stop)) {
+            error = "checksum mismatch";
+            return nullptr;
+        }
+        SnapshotReader in(payload, stop);
+        ManualGraph* graph = attachSections(header, in, error);
+        if (graph == nullptr) return nullptr;
+        graph->mappedBase = file.data;
+        graph->mappedBytes = file.size;
+        file.release(); // unmapped by the destructor
+        return graph;
+    }
+    // Points a graph at the typed constexpr arrays of an embedded header
+    // (see writeEmbeddedHeader). The search code runs over them directly;
+    // only the section sizes are checked.
+    static ManualGraph* attachEmbedded(const long long* header, const EmbeddedSection* sections, int numSections,
+                                       string& error) {
+        if (!checkHeader(header, error)) return nullptr;
+        SnapshotReader in(sections, numSections);
+        return attachSections(header, in, error);
+    }
+    static bool checkHeader(const long long* header, string& error) {
+        if (header[0] != SNAPSHOT_MAGIC) {
+            error = "not a graph snapshot";
+        } else if (header[1] != SNAPSHOT_VERSION) {
+            error = "snapshot version " + to_string(header[1]) + ", expected " + to_string(SNAPSHOT_VERSION);
+        } else if (header[4] < 0) {
+            error = "truncated snapshot";
+        }
+        return error.empty();
+    }
+    // Builds a graph over the sections of 'in', borrowing every array.
+    static ManualGraph* attachSections(const long long* header, SnapshotReader& in, string& error) {
+        ManualGraph* graph = new ManualGraph();
+        graph->borrowedArrays = true;
+        int V = (int)header[4];
+        graph->numVertices = V;
+        graph->currentNodeIndex = V;
+        graph->numEdges = (int)header[5];
+        graph->maxEdgeWeight = (int)header[6];
+        graph->nodeOrder = (NodeOrder)header[7];
+        graph->numUndirected = (int)header[8];
+        graph->numOneWay = (int)header[9];
+        memcpy(&graph->heuristicScale, &header[11], sizeof(double));
+        graph->frozen = true;
+
+        long long count = 0;
+        graph->names = new NamePool(0, 0);
+        bool ok = graph->names->readSnapshot(in) && graph->names->size() == V;
+        graph->nodeX = in.take<int>(V);
+        graph->nodeY = in.take<int>(V);
+        graph->nodeType = in.take<unsigned char>(V);
+        graph->externalId = in.takeAny<int>(count);
+        ok = ok && (count == 0 || count == V);
+        graph->internalId = in.takeAny<int>(count);
+        ok = ok && (count == 0 || count == V);
+        graph->blockStart = in.take<int>(V + 1);
+        graph->undirectedStart = in.take<int>(V);
+        graph->outOnlyStart = in.take<int>(V);
+        graph->edgeTargets = in.takeAny<int>(count);
+        graph->edgeWeights = in.take<int>(count);
+        ok = ok && in.ok && graph->blockStart[0] == 0 && graph->blockStart[V] == count;
+        for (int u = 0; ok && u < V; ++u) {
+            ok = graph->blockStart[u] <= graph->undirectedStart[u] && graph->undirectedStart[u] <= graph->outOnlyStart[u] &&
+                 graph->outOnlyStart[u] <= graph->blockStart[u + 1];
+        }
+        for (long long e = 0; ok && e < count; ++e) ok = graph->edgeTargets[e] >= 0 && graph->edgeTargets[e] < V;
+        if (ok && header[10] != 0) {
+            graph->idHash = new NodeIdPerfectHash();
+            ok = graph->idHash->readSnapshot(in, graph->names);
+        } else if (ok) {
+            graph->nodeMap = new HashTable(16, graph->names);
+            ok = graph->nodeMap->readSnapshot(in);
+        }
+        graph->prefixIndex = new NamePrefixIndex();
+        ok = ok && graph->prefixIndex->readSnapshot(in, graph->names);
+        graph->doorGroups = new DoorGroups();
+        ok = ok && graph->doorGroups->readSnapshot(in, V);
+        if (!ok || !in.ok) {
+            error = "malformed snapshot section";
+            delete graph;
+            return nullptr;
+        }
+        graph->outEdges.begin = graph->undirectedStart;
+        graph->outEdges.end = graph->blockStart + 1;
+        graph->inEdges.begin = graph->blockStart;
+        graph->inEdges.end = graph->outOnlyStart;
+        graph->outEdges.targets = graph->inEdges.targets = graph->edgeTargets;
+        graph->outEdges.weights = graph->inEdges.weights = graph->edgeWeights;
+        return graph;
+    }
+    double pixelDistance(int a, int b) const {
+        double dx = nodeX[a] - nodeX[b];
+        double dy = nodeY[a] - nodeY[b];
+        return sqrt(dx * dx + dy * dy);
+    }
+    // Call once after all edges are loaded: renumbers the nodes in the given
+    // order, packs the edges into the shared CSR block (mirrored pairs stored
+    // once) and frees the list nodes.
+    void freeze(NodeOrder order = ORDER_INPUT) {
+        if (frozen) return;
+        int* newOrder = new int[numVertices];
+        computeOrder(order, newOrder);
+        applyOrder(newOrder);
+        nodeOrder = order;
+        delete[] newOrder;
+        listsToArrays();
+        frozen = true;
+        idHash = new NodeIdPerfectHash();
+        if (!idHash->build(names, currentNodeIndex)) {
+            delete idHash;
+            idHash = nullptr;
+        }
+        prefixIndex = new NamePrefixIndex();
+        prefixIndex->build(names);
+        doorGroups = new DoorGroups();
+        doorGroups->build(names, roomNames, roomOf);
+        delete roomNames;
+        delete[] roomOf;
+        roomNames = nullptr;
+        roomOf = nullptr;
+        computeHeuristicScale();
+    }
+    // The scale is the smallest weight / pixel-length ratio over all edges,
+    // so scale * pixelDistance never overestimates the remaining weight
+    // (admissible and consistent).
+    void computeHeuristicScale() {
+        double scale = -1.0;
+        for (int u = 0; u < numVertices; ++u) {
+            for (int e = outEdges.begin[u]; e < outEdges.end[u]; ++e) {
+                double len = pixelDistance(u, outEdges.target(e));
+                if (len <= 0.0) continue;
+                double ratio = outEdges.weight(e) / len;
+                if (scale < 0.0 || ratio < scale) scale = ratio;
+            }
+        }
+        // Shave off a little to absorb floating point rounding
+        heuristicScale = scale > 0.0 ? scale * (1.0 - 1e-9) : 0.0;
+    }
+    static const int SNAPSHOT_HEADER_WORDS = 16;
+private:
+    static const long long SNAPSHOT_MAGIC = 0x50414e5346500001LL; // "PFSNAP"
+    static const long long SNAPSHOT_VERSION = 1;
+    bool borrowedArrays; // node and edge arrays live in a snapshot image
+    const char* mappedBase; // snapshot file mapping to release, or null
+    long long mappedBytes;
+
+    // Empty graph; the public constructor and mapSnapshot() fill it in.
+    ManualGraph() : numVertices(0), adjLists(nullptr), reverseAdjLists(nullptr), blockStart(nullptr),
+        undirectedStart(nullptr), outOnlyStart(nullptr), edgeTargets(nullptr), edgeWeights(nullptr),
+        numUndirected(0), numOneWay(0), packedEdges(nullptr), weightTable(nullptr), numWeightClasses(0),
+        frozen(false), nodeMap(nullptr), idHash(nullptr), names(nullptr), prefixIndex(nullptr),
+        doorGroups(nullptr), fuzzyIndex(nullptr), nodeOrder(ORDER_INPUT), externalId(nullptr),
+        internalId(nullptr), roomNames(nullptr), roomOf(nullptr), nodeX(nullptr), nodeY(nullptr),
+        nodeType(nullptr), numEdges(0), maxEdgeWeight(0), heuristicScale(0.0), ch(nullptr),
+        landmarks(nullptr), table(nullptr), hubLabels(nullptr), currentNodeIndex(0), borrowedArrays(false),
+        mappedBase(nullptr), mappedBytes(0) {}
+    // newOrder[k] = current index of the node that becomes node k. Only the
+    // first currentNodeIndex slots are nodes; unused slots keep their place.
+    void computeOrder(NodeOrder order, int* newOrder) {
+        int n = currentNodeIndex;
+        for (int i = 0; i < numVertices; ++i) newOrder[i] = i;
+        if (order == ORDER_HILBERT && n > 0) {
+            int minX = nodeX[0], maxX = nodeX[0], minY = nodeY[0], maxY = nodeY[0];
+            for (int i = 1; i < n; ++i) {
+                if (nodeX[i] < minX) minX = nodeX[i];
+                if (nodeX[i] > maxX) maxX = nodeX[i];
+                if (nodeY[i] < minY) minY = nodeY[i];
+                if (nodeY[i] > maxY) maxY = nodeY[i];
+            }
+            double span = maxX - minX > maxY - minY ? maxX - minX : maxY - minY;
+            double scale = span > 0 ? 65535.0 / span : 0.0;
+            unsigned int* keys = new unsigned int[n];
+            for (int i = 0; i < n; ++i) {
+                keys[i] = hilbertIndex((unsigned int)((nodeX[i] - minX) * scale), (unsigned int)((nodeY[i] - minY) * scale));
+            }
+            radixSortByKey(keys, newOrder, n); // stable, so ties keep input order
+            delete[] keys;
+        } else if (order == ORDER_BFS || order == ORDER_RCM) {
+            // degree over both directions, as the searches see it
+            int* degree = new int[n > 0 ? n : 1];
+            for (int u = 0; u < n; ++u) {
+                degree[u] = 0;
+                for (AdjListNode* e = adjLists[u]; e != nullptr; e = e->next) degree[u]++;
+                for (AdjListNode* e = reverseAdjLists[u]; e != nullptr; e = e->next) degree[u]++;
+            }
+            bool* visited = new bool[n > 0 ? n : 1];
+            for (int u = 0; u < n; ++u) visited[u] = false;
+            int* neighbours = new int[n > 0 ? n : 1];
+            int head = 0, tail = 0;
+            for (int scan = 0; scan < n; ++scan) {
+                // a new component: BFS starts at its first node in input
+                // order, Cuthill-McKee at a node of minimum degree in it
+                int root = scan;
+                if (visited[root]) continue;
+                if (order == ORDER_RCM) root = minimumDegreeInComponent(root, degree, visited, newOrder + tail);
+                visited[root] = true;
+                newOrder[tail++] = root;
+                while (head < tail) {
+                    int u = newOrder[head++];
+                    int count = 0;
+                    for (int dir = 0; dir < 2; ++dir) {
+                        for (AdjListNode* e = dir == 0 ? adjLists[u] : reverseAdjLists[u]; e != nullptr; e = e->next) {
+                            if (visited[e->destIndex]) continue;
+                            visited[e->destIndex] = true;
+                            neighbours[count++] = e->destIndex;
+                        }
+                    }
+                    if (order == ORDER_RCM) {
+                        // Cuthill-McKee visits neighbours by increasing degree
+                        for (int i = 1; i < count; ++i) {
+                            int v = neighbours[i];
+                            int j = i;
+                            while (j > 0 && degree[neighbours[j - 1]] > degree[v]) {
+                                neighbours[j] = neighbours[j - 1];
+                                j--;
+                            }
+                            neighbours[j] = v;
+                        }
+                    }
+                    for (int i = 0; i < count; ++i) newOrder[tail++] = neighbours[i];
+                }
+            }
+            if (order == ORDER_RCM) {
+                for (int i = 0, j = n - 1; i < j; ++i, --j) {
+                    int t = newOrder[i];
+                    newOrder[i] = newOrder[j];
+                    newOrder[j] = t;
+                }
+            }
+            delete[] degree;
+            delete[] visited;
+            delete[] neighbours;
+        }
+    }
+    // Node of minimum degree in the unvisited component of 'start', found by
+    // a throwaway BFS that uses 'queue' as scratch and leaves 'visited' as it was.
+    int minimumDegreeInComponent(int start, const int* degree, bool* visited, int* queue) {
+        int head = 0, tail = 0;
+        int best = start;
+        visited[start] = true;
+        queue[tail++] = start;
+        while (head < tail) {
+            int u = queue[head++];
+            if (degree[u] < degree[best]) best = u;
+            for (int dir = 0; dir < 2; ++dir) {
+                for (AdjListNode* e = dir == 0 ? adjLists[u] : reverseAdjLists[u]; e != nullptr; e = e->next) {
+                    if (visited[e->destIndex]) continue;
+                    visited[e->destIndex] = true;
+                    queue[tail++] = e->destIndex;
+                }
+            }
+        }
+        for (int i = 0; i < tail; ++i) visited[queue[i]] = false;
+        return best;
+    }
+    // Renumbers every per-node array, the adjacency lists and the names;
+    // node k gets input position externalId[k].
+    void applyOrder(const int* newOrder) {
+        externalId = new int[numVertices];
+        internalId = new int[numVertices];
+        for (int k = 0; k < numVertices; ++k) {
+            externalId[k] = newOrder[k];
+            internalId[newOrder[k]] = k;
+        }
+        bool identity = true;
+        for (int k = 0; k < numVertices && identity; ++k) identity = newOrder[k] == k;
+        if (identity) return;
+
+        AdjListNode** lists[2] = {adjLists, reverseAdjLists};
+        for (int l = 0; l < 2; ++l) {
+            AdjListNode** renumbered = new AdjListNode*[numVertices];
+            for (int k = 0; k < numVertices; ++k) {
+                renumbered[k] = lists[l][newOrder[k]];
+                for (AdjListNode* e = renumbered[k]; e != nullptr; e = e->next) e->destIndex = internalId[e->destIndex];
+            }
+            memcpy(lists[l], renumbered, numVertices * sizeof(AdjListNode*));
+            delete[] renumbered;
+        }
+        int* x = new int[numVertices];
+        int* y = new int[numVertices];
+        unsigned char* type = new unsigned char[numVertices];
+        for (int k = 0; k < numVertices; ++k) {
+            x[k] = nodeX[newOrder[k]];
+            y[k] = nodeY[newOrder[k]];
+            type[k] = nodeType[newOrder[k]];
+        }
+        delete[] nodeX;
+        delete[] nodeY;
+        delete[] nodeType;
+        nodeX = x;
+        nodeY = y;
+        nodeType = type;
+        if (roomOf != nullptr) {
+            int* rooms = new int[numVertices];
+            for (int k = 0; k < numVertices; ++k) rooms[k] = roomOf[newOrder[k]];
+            delete[] roomOf;
+            roomOf = rooms;
+        }
+        // name id == node index, so the pool and the node map are rebuilt
+        int nameChars = 0;
+        for (int k = 0; k < currentNodeIndex; ++k) nameChars += names->length(k) + 1;
+        NamePool* renamed = new NamePool(numVertices, nameChars);
+        HashTable* renamedMap = new HashTable(numVertices * 2, renamed);
+        for (int k = 0; k < currentNodeIndex; ++k) renamedMap->insert(names->c_str(newOrder[k]), k);
+        delete nodeMap;
+        delete names;
+        names = renamed;
+        nodeMap = renamedMap;
+    }
+    static void freeLists(AdjListNode** lists, int count) {
+        for (int u = 0; u < count; ++u) {
+            AdjListNode* current = lists[u];
+            while (current != nullptr) {
+                AdjListNode* temp = current;
+                current = current->next;
+                delete temp;
+            }
+            lists[u] = nullptr;
+        }
+    }
+    // Builds the edge blocks from adjLists. Each edge u->v is paired with an
+    // unpaired v->u of the same weight if there is one; pairs are stored as
+    // one undirected entry per endpoint instead of an out and an in entry at
+    // both ends, which halves the storage of a mostly two-way graph.
+    void listsToArrays() {
+        // temporary out CSR, in list order
+        int* offsets = new int[numVertices + 1];
+        offsets[0] = 0;
+        for (int u = 0; u < numVertices; ++u) {
+            int degree = 0;
+            for (AdjListNode* e = adjLists[u]; e != nullptr; e = e->next) degree++;
+            offsets[u + 1] = offsets[u] + degree;
+        }
+        int total = offsets[numVertices];
+        int* targets = new int[total];
+        int* weights = new int[total];
+        for (int u = 0; u < numVertices; ++u) {
+            int slot = offsets[u];
+            for (AdjListNode* e = adjLists[u]; e != nullptr; e = e->next) {
+                targets[slot] = e->destIndex;
+                weights[slot] = e->weight;
+                slot++;
+            }
+        }
+        freeLists(adjLists, numVertices);
+        freeLists(reverseAdjLists, numVertices);
+
+        // Pair u->v with v->u of equal weight: sort the non-loop edges by
+        // (min(u,v), max(u,v), weight) with three stable radix passes, then
+        // match the edges of each group leaving the smaller end with those
+        // leaving the larger end, in list order. O(E) instead of scanning
+        // the partner's whole list for every edge.
+        bool* paired = new bool[total];
+        int* source = new int[total > 0 ? total : 1];
+        int* order = new int[total > 0 ? total : 1];
+        unsigned int* keys = new unsigned int[total > 0 ? total : 1];
+        int candidates = 0;
+        for (int u = 0; u < numVertices; ++u) {
+            for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                paired[e] = false;
+                source[e] = u;
+                if (targets[e] != u) order[candidates++] = e;
+            }
+        }
+        for (int pass = 0; pass < 3; ++pass) {
+            for (int i = 0; i < candidates; ++i) {
+                int e = order[i];
+                int low = source[e] < targets[e] ? source[e] : targets[e];
+                int high = source[e] < targets[e] ? targets[e] : source[e];
+                keys[i] = pass == 0 ? (unsigned int)weights[e] : pass == 1 ? (unsigned int)high : (unsigned int)low;
+            }
+            radixSortByKey(keys, order, candidates);
+        }
+        numUndirected = 0;
+        for (int first = 0; first < candidates;) {
+            int e = order[first];
+            int last = first + 1;
+            while (last < candidates) {
+                int f = order[last];
+                bool sameEnds = (source[f] == source[e] && targets[f] == targets[e]) ||
+                                (source[f] == targets[e] && targets[f] == source[e]);
+                if (!sameEnds || weights[f] != weights[e]) break;
+                last++;
+            }
+            // the group is in list order; walk both directions side by side
+            int low = source[e] < targets[e] ? source[e] : targets[e];
+            int down = first, up = first;
+            while (true) {
+                while (down < last && source[order[down]] != low) down++;
+                while (up < last && source[order[up]] == low) up++;
+                if (down == last || up == last) break;
+                paired[order[down++]] = true;
+                paired[order[up++]] = true;
+                numUndirected++;
+            }
+            first = last;
+        }
+        delete[] source;
+        delete[] order;
+        delete[] keys;
+        numOneWay = total - 2 * numUndirected;
+
+        // per node counts: in-only, undirected, out-only
+        int* inOnly = new int[numVertices];
+        int* undirected = new int[numVertices];
+        int* outOnly = new int[numVertices];
+        for (int u = 0; u < numVertices; ++u) {
+            inOnly[u] = 0;
+            undirected[u] = 0;
+            outOnly[u] = 0;
+        }
+        for (int u = 0; u < numVertices; ++u) {
+            for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                if (paired[e]) {
+                    undirected[u]++;
+                } else {
+                    outOnly[u]++;
+                    inOnly[targets[e]]++;
+                }
+            }
+        }
+        blockStart = new int[numVertices + 1];
+        undirectedStart = new int[numVertices];
+        outOnlyStart = new int[numVertices];
+        blockStart[0] = 0;
+        for (int u = 0; u < numVertices; ++u) {
+            undirectedStart[u] = blockStart[u] + inOnly[u];
+            outOnlyStart[u] = undirectedStart[u] + undirected[u];
+            blockStart[u + 1] = outOnlyStart[u] + outOnly[u];
+        }
+        int stored = blockStart[numVertices];
+        edgeTargets = new int[stored];
+        edgeWeights = new int[stored];
+        // reuse the counters as fill cursors
+        for (int u = 0; u < numVertices; ++u) {
+            inOnly[u] = blockStart[u];
+            undirected[u] = undirectedStart[u];
+            outOnly[u] = outOnlyStart[u];
+        }
+        for (int u = 0; u < numVertices; ++u) {
+            for (int e = offsets[u]; e < offsets[u + 1]; ++e) {
+                int v = targets[e];
+                int slot;
+                if (paired[e]) {
+                    slot = undirected[u]++;
+                } else {
+                    slot = outOnly[u]++;
+                    int back = inOnly[v]++;
+                    edgeTargets[back] = u;
+                    edgeWeights[back] = weights[e];
+                }
+                edgeTargets[slot] = v;
+                edgeWeights[slot] = weights[e];
+            }
+        }
+        outEdges.begin = undirectedStart;
+        outEdges.end = blockStart + 1;
+        inEdges.begin = blockStart;
+        inEdges.end = outOnlyStart;
+        outEdges.targets = inEdges.targets = edgeTargets;
+        outEdges.weights = inEdges.weights = edgeWeights;
+        delete[] inOnly;
+        delete[] undirected;
+        delete[] outOnly;
+        delete[] paired;
+        delete[] offsets;
+        delete[] targets;
+        delete[] weights;
+    }
+};
+
+
+
+// list that stires doors variation, as node indices into the name pool
+struct StringNode {
+    int index;
+    StringNode* next;
+};
+
+class StringList {
+public:
+    StringNode* head;
+    int count;
+    StringList() : head(nullptr), count(0) {}
+    ~StringList() {
+        StringNode* current = head;
+        while (current != nullptr) {
+            StringNode* temp = current;
+            current = current->next;
+            delete temp;
+        }
+    }
+    void push(int index) {
+        StringNode* newNode = new StringNode();
+        newNode->index = index;
+        newNode->next = head;
+        head = newNode;
+        count++;
+    }
+};
+
+// Linear scan for door variants, used before the prefix index is built
+// (and as the baseline for --bench doors).
+void scanNodeVariations(ManualGraph* graph, string_view base, StringList* list) {
+    for (int i = 0; i < graph->names->size(); ++i) {
+        string_view nodeName = graph->names->view(i);
+        if (nodeName.size() > base.size() && nodeName.size() <= base.size() + 2 &&
+            nodeName.compare(0, base.size(), base) == 0) {
+            list->push(i);
+        }
+    }
+}
+
+// Door variants from the prefix index: the base plus 1 or 2 characters are
+// two binary-searched ranges.
+void indexNodeVariations(ManualGraph* graph, string_view base, StringList* list) {
+    for (int extra = 1; extra <= 2; ++extra) {
+        int begin, end;
+        graph->prefixIndex->findRange(base, (int)base.size() + extra, begin, end);
+        for (int p = begin; p < end; ++p) list->push(graph->prefixIndex->at(p));
+    }
+}
+
+StringList* findNodeVariations(ManualGraph* graph, const char* name) {
+    StringList* list = new StringList();
+    int nameLen = strlen(name);
+    int exact = graph->indexOf(name);
+    if (exact != -1) {
+        list->push(exact);
+        return list;
+    }
+    string_view base(name, nameLen);
+    if (graph->prefixIndex != nullptr) {
+        indexNodeVariations(graph, base, list);
+    } else {
+        scanNodeVariations(graph, base, list);
+    }
+    return list;
+}
+
+
+// Door indices for a typed name: the node itself, else the doors of its room,
+// both read straight from the door-group table. Names that are neither fall
+// back to the prefix rule of findNodeVariations; only then are the indices
+// copied into 'buffer', which the caller deletes.
+int resolveDoors(ManualGraph* graph, const char* name, const int*& doors, int*& buffer) {
+    buffer = nullptr;
+    if (graph->doorGroups != nullptr) {
+        int exact = graph->indexOf(name);
+        if (exact != -1) {
+            doors = graph->doorGroups->nodeAsDoor(exact);
+            return 1;
+        }
+        int count = graph->doorGroups->roomDoors(name, doors);
+        if (count > 0) return count;
+    }
+    StringList* list = findNodeVariations(graph, name);
+    int count = list->count;
+    buffer = new int[count > 0 ? count : 1];
+    int k = 0;
+    for (StringNode* node = list->head; node != nullptr; node = node->next) buffer[k++] = node->index;
+    delete list;
+    doors = buffer;
+    return count;
+}
+
+// resolveDoors for the prompt: a name that matches nothing is replaced by the
+// one fuzzy entry that differs from it only in case or separators (cp-30 ->
+// CP30), if there is exactly one.
+int resolveTypedName(ManualGraph* graph, string& typed, const int*& doors, int*& buffer) {
+    int count = resolveDoors(graph, typed.c_str(), doors, buffer);
+    if (count > 0) return count;
+    delete[] buffer;
+    buffer = nullptr;
+    FuzzyMatch matches[2];
+    int found = graph->fuzzy()->suggest(typed.c_str(), 2, matches);
+    bool unique = found == 1 || (found == 2 && (matches[1].edits > 0 || matches[1].extra > 0));
+    if (found == 0 || matches[0].edits != 0 || matches[0].extra != 0 || !unique) return 0;
+    typed = string(graph->fuzzy()->name(matches[0].entry));
+    return resolveDoors(graph, typed.c_str(), doors, buffer);
+}
+
+void printSuggestions(ManualGraph* graph, const string& typed) {
+    const int limit = 5;
+    FuzzyMatch matches[limit];
+    int found = graph->fuzzy()->suggest(typed.c_str(), limit, matches);
+    if (found == 0) return;
+    cout << "Did you mean: ";
+    for (int i = 0; i < found; ++i) {
+        cout << (i > 0 ? ", " : "") << graph->fuzzy()->name(matches[i].entry);
+    }
+    cout << "?" << endl;
+}
+
+
+
+// Dijkstra's Algorithm 
+
+const int INF = 2147483647;
+
+// This struct holds the result of a single Dijkstra run
+struct PathResult {
+    int distance;
+    int* previous; // 'previous' array in the SearchWorkspace, not owned
+    int startIndex;
+    int endIndex;
+    int settled; // nodes taken out of the queue, for comparing engines
+
+    PathResult() : distance(INF), previous(nullptr), startIndex(-1), endIndex(-1), settled(0) {}
+};
+
+// Growable int stack without per-push allocation once it has grown, used for
+// unpacking paths inside a SearchWorkspace.
+struct IntStack {
+    int* items;
+    int size;
+    int capacity;
+    IntStack() : items(nullptr), size(0), capacity(0) {}
+    ~IntStack() {
+        delete[] items;
+    }
+    bool isEmpty() {
+        return size == 0;
+    }
+    void push(int value) {
+        if (size == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            int* grown = new int[capacity];
+            for (int i = 0; i < size; ++i) grown[i] = items[i];
+            delete[] items;
+            items = grown;
+        }
+        items[size++] = value;
+    }
+    int pop() {
+        return items[--size];
+    }
+};
+
+// One direction of a search: distance, parent and origin per node, plus one
+// engine-specific value (the A* heuristic cache, which A* clears itself on a
+// node's first touch). A distance only counts when the stamp next to it
+// equals the side's generation; every other node reads as unreached, so
+// reset() is O(1) and a query only writes the slots it touches.
+struct StampedDistance {
+    unsigned int stamp;
+    int distance;
+};
+
+class SearchSide {
+private:
+    StampedDistance* slots; // stamp and distance share a cache line
+    unsigned int generation;
+    int capacity;
+public:
+    int* parent;
+    int* origin;
+    int* extra;
+
+    SearchSide() : slots(nullptr), generation(0), capacity(0), parent(nullptr), origin(nullptr), extra(nullptr) {}
+    ~SearchSide() {
+        delete[] slots;
+        delete[] parent;
+        delete[] origin;
+        delete[] extra;
+    }
+    void reserve(int vertices) {
+        if (vertices <= capacity) return;
+        delete[] slots;
+        delete[] parent;
+        delete[] origin;
+        delete[] extra;
+        capacity = vertices;
+        slots = new StampedDistance[capacity];
+        parent = new int[capacity];
+        origin = new int[capacity];
+        extra = new int[capacity];
+        for (int i = 0; i < capacity; ++i) slots[i].stamp = 0;
+        generation = 0;
+    }
+    void reset() {
+        if (++generation == 0) {
+            // stamps wrapped around: clear them once every 2^32 searches
+            for (int i = 0; i < capacity; ++i) slots[i].stamp = 0;
+            generation = 1;
+        }
+    }
+    bool reached(int v) const {
+        return slots[v].stamp == generation;
+    }
+    int dist(int v) const {
+        return slots[v].stamp == generation ? slots[v].distance : INF;
+    }
+    void set(int v, int d, int from, int originDoor) {
+        slots[v].stamp = generation;
+        slots[v].distance = d;
+        parent[v] = from;
+        origin[v] = originDoor;
+    }
+};
+
+// Everything a query needs besides the graph, allocated once and reused:
+// a forward and a backward SearchSide, the queues, the 'path' array that
+// engines without a search tree fill as their 'previous', and scratch stacks.
+// PathResult.previous points into the workspace and stays valid until the
+// next query on it. Use one workspace per thread.
+class SearchWorkspace {
+private:
+    int capacity;
+    DialQueue* dial;
+    int dialWeight;
+public:
+    SearchSide forward;
+    SearchSide backward;
+    int* path;
+    MinPriorityQueue* heapF;
+    MinPriorityQueue* heapB;
+    RadixHeap radix;
+    IntStack chain;
+    IntStack ordered;
+
+    IntStack route;   // node sequence of an unpacked path, see extendRoute()
+    int* routeIndex;  // position of each node on 'route', -1 when not on it
+
+    SearchWorkspace() : capacity(0), dial(nullptr), dialWeight(-1), path(nullptr), heapF(nullptr), heapB(nullptr),
+                        routeIndex(nullptr) {}
+    ~SearchWorkspace() {
+        delete[] path;
+        delete[] routeIndex;
+        delete heapF;
+        delete heapB;
+        delete dial;
+    }
+    // Grows the storage to the graph; a no-op once it fits, so steady-state
+    // queries allocate nothing.
+    void prepare(int vertices) {
+        if (vertices > capacity) {
+            delete[] path;
+            delete[] routeIndex;
+            delete heapF;
+            delete heapB;
+            capacity = vertices;
+            path = new int[capacity];
+            routeIndex = new int[capacity];
+            for (int v = 0; v < capacity; ++v) routeIndex[v] = -1;
+            heapF = new MinPriorityQueue(capacity);
+            heapB = new MinPriorityQueue(capacity);
+        }
+        forward.reserve(vertices);
+        backward.reserve(vertices);
+    }
+    // Engines that rebuild a path from pieces (CH shortcuts, hub label
+    // halves) append its nodes in order here. With zero-weight edges a node
+    // can come up twice; the loop between the two visits weighs 0 and is cut,
+    // so the route stays a simple path.
+    void extendRoute(int v) {
+        if (routeIndex[v] != -1) {
+            while (route.size > routeIndex[v] + 1) routeIndex[route.items[--route.size]] = -1;
+            return;
+        }
+        routeIndex[v] = route.size;
+        route.push(v);
+    }
+    // Writes the route into 'path' as parent links, clears it and returns
+    // its first and last node.
+    void finishRoute(int& first, int& last) {
+        first = route.items[0];
+        last = route.items[route.size - 1];
+        for (int i = 0; i < route.size; ++i) {
+            path[route.items[i]] = i > 0 ? route.items[i - 1] : -1;
+            routeIndex[route.items[i]] = -1;
+        }
+        route.size = 0;
+    }
+    DialQueue& dialQueue(int maxEdgeWeight) {
+        if (maxEdgeWeight != dialWeight) {
+            delete dial;
+            dialWeight = maxEdgeWeight;
+            dial = new DialQueue(dialWeight);
+        }
+        return *dial;
+    }
+};
+
+// Multi-source / multi-target Dijkstra (doors problem): every start door is
+// seeded at distance 0 and the search stops as soon as any end door is settled.
+// The chosen door pair is returned in result.startIndex / result.endIndex.
+// Works with any queue backend; insert() lowers the key of a queued node on
+// MinPriorityQueue and adds a duplicate on the monotone queues.
+template <class Queue>
+void dijkstraSearch(ManualGraph* graph, const int* startIndices, int numStarts,
+                    const int* endIndices, int numEnds, Queue& pq, SearchSide& side, PathResult& result) {
+    // 1. Start from a clean side and queue, O(1) and O(queued)
+    side.reset();
+    pq.clear();
+
+    // 2. Seed every start door
+    for (int s = 0; s < numStarts; ++s) {
+        int startIndex = startIndices[s];
+        if (side.dist(startIndex) == 0) continue; // duplicate door
+        side.set(startIndex, 0, -1, startIndex);
+        pq.insert(startIndex, 0);
+    }
+
+    // 3. Main Loop
+    int reached = -1;
+    int settled = 0;
+    while (!pq.isEmpty()) {
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+        int u_dist = minNode.distance;
+
+        if (u_dist > side.dist(u)) {
+            continue;
+        }
+        settled++;
+
+        // If we settled any end door, we can stop.
+        bool isEnd = false;
+        for (int t = 0; t < numEnds; ++t) {
+            if (endIndices[t] == u) {
+                isEnd = true;
+                break;
+            }
+        }
+        if (isEnd) {
+            reached = u;
+            break;
+        }
+
+        // Loop over all neighbors
+        const EdgeArrays& edges = graph->outEdges;
+        for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+            int v = edges.target(e);
+            int weight = edges.weight(e);
+            int newDist = u_dist + weight;
+            if (newDist < side.dist(v)) {
+                side.set(v, newDist, u, side.origin[u]);
+                pq.insert(v, newDist);
+            }
+        }
+    }
+
+    // Store results in the struct
+    result.settled = settled;
+    if (reached != -1) {
+        result.distance = side.dist(reached);
+        result.previous = side.parent;
+        result.startIndex = side.origin[reached];
+        result.endIndex = reached;
+    } else {
+        result.distance = INF;
+        result.previous = nullptr;
+    }
+}
+
+void dijkstraMulti(ManualGraph* graph, const int* startIndices, int numStarts,
+                   const int* endIndices, int numEnds, PathResult& result, SearchWorkspace& workspace,
+                   QueueBackend backend = DIJKSTRA_QUEUE) {
+    workspace.prepare(graph->numVertices);
+    switch (effectiveQueue(backend, graph->maxEdgeWeight)) {
+        case QUEUE_RADIX:
+            dijkstraSearch(graph, startIndices, numStarts, endIndices, numEnds, workspace.radix,
+                           workspace.forward, result);
+            break;
+        case QUEUE_DIAL:
+            dijkstraSearch(graph, startIndices, numStarts, endIndices, numEnds, workspace.dialQueue(graph->maxEdgeWeight),
+                           workspace.forward, result);
+            break;
+        default:
+            dijkstraSearch(graph, startIndices, numStarts, endIndices, numEnds, *workspace.heapF,
+                           workspace.forward, result);
+            break;
+    }
+}
+
+// Single pair search, kept for callers that already know the exact doors.
+void dijkstra(ManualGraph* graph, int startIndex, int endIndex, PathResult& result, SearchWorkspace& workspace) {
+    dijkstraMulti(graph, &startIndex, 1, &endIndex, 1, result, workspace);
+}
+
+
+
+// Full single source search, used by the preprocessing steps. With
+// 'backward' set it follows the reversed edges, so distances[v] is the distance
+// from v to 'source' instead. 'previous' may be null.
+void singleSourceDistances(ManualGraph* graph, int source, bool backward, int* distances, int* previous) {
+    int V = graph->numVertices;
+    for (int i = 0; i < V; ++i) {
+        distances[i] = INF;
+        if (previous != nullptr) previous[i] = -1;
+    }
+    const EdgeArrays& edges = backward ? graph->inEdges : graph->outEdges;
+    MinPriorityQueue pq(V);
+    distances[source] = 0;
+    pq.insert(source, 0);
+    while (!pq.isEmpty()) {
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+        if (minNode.distance > distances[u]) continue;
+        for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+            int v = edges.target(e);
+            int newDist = distances[u] + edges.weight(e);
+            if (newDist < distances[v]) {
+                distances[v] = newDist;
+                if (previous != nullptr) previous[v] = u;
+                pq.insert(v, newDist);
+            }
+        }
+    }
+}
+
+
+
+// ALT landmarks: distances from and to a few landmark nodes give lower bounds
+// through the triangle inequality, d(v,t) >= d(L,t) - d(L,v) and
+// d(v,t) >= d(v,L) - d(t,L). Entrances are taken first, the rest are
+// farthest-point picks. Tables are node major so one node's bounds share a cache line.
+class LandmarkTable {
+public:
+    int numVertices;
+    int numEdges;
+    int numLandmarks;
+    int nodeOrder; // NodeOrder of the graph the distances belong to
+    unsigned long long edgeHash; // ManualGraph::edgeHash() of that graph
+    int* landmarks;
+    int* fromLandmark; // fromLandmark[v * numLandmarks + k] = d(landmark k, v)
+    int* toLandmark;   // toLandmark[v * numLandmarks + k]   = d(v, landmark k)
+    double preprocessMillis;
+
+    LandmarkTable() : numVertices(0), numEdges(0), numLandmarks(0), nodeOrder(ORDER_INPUT), edgeHash(0), landmarks(nullptr),
+        fromLandmark(nullptr), toLandmark(nullptr), preprocessMillis(0.0) {}
+    ~LandmarkTable() {
+        delete[] landmarks;
+        delete[] fromLandmark;
+        delete[] toLandmark;
+    }
+
+    void build(ManualGraph* graph, int maxLandmarks) {
+        auto startTime = chrono::steady_clock::now();
+        numVertices = graph->numVertices;
+        numEdges = graph->numEdges;
+        nodeOrder = graph->nodeOrder;
+        edgeHash = graph->edgeHash();
+        if (maxLandmarks > numVertices) maxLandmarks = numVertices;
+        landmarks = new int[maxLandmarks];
+        fromLandmark = new int[(long long)numVertices * maxLandmarks];
+        toLandmark = new int[(long long)numVertices * maxLandmarks];
+        numLandmarks = 0;
+
+        int* distances = new int[numVertices];
+        int* closest = new int[numVertices]; // distance to the nearest picked landmark
+        for (int v = 0; v < numVertices; ++v) closest[v] = INF;
+
+        while (numLandmarks < maxLandmarks) {
+            int next = -1;
+            for (int v = 0; v < numVertices && next == -1; ++v) {
+                if (graph->nodeType[v] == NODE_ENTRANCE && closest[v] != 0) next = v;
+            }
+            if (next == -1) {
+                // farthest reachable node from the landmarks picked so far
+                int farthest = -1;
+                for (int v = 0; v < numVertices; ++v) {
+                    if (closest[v] == 0) continue;
+                    if (farthest == -1 || (closest[v] != INF && (closest[farthest] == INF || closest[v] > closest[farthest]))) {
+                        farthest = v;
+                    }
+                }
+                if (farthest == -1) break;
+                next = farthest;
+            }
+
+            int k = numLandmarks++;
+            landmarks[k] = next;
+            singleSourceDistances(graph, next, false, distances, nullptr);
+            for (int v = 0; v < numVertices; ++v) {
+                fromLandmark[(long long)v * maxLandmarks + k] = distances[v];
+                if (distances[v] < closest[v]) closest[v] = distances[v];
+            }
+            singleSourceDistances(graph, next, true, distances, nullptr);
+            for (int v = 0; v < numVertices; ++v) {
+                toLandmark[(long long)v * maxLandmarks + k] = distances[v];
+            }
+        }
+        // rows were laid out for maxLandmarks columns
+        compact(maxLandmarks);
+
+        delete[] distances;
+        delete[] closest;
+        preprocessMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+
+    // Lower bound on d(v, t)
+    int lowerBound(int v, int t) const {
+        const int* fromV = fromLandmark + (long long)v * numLandmarks;
+        const int* fromT = fromLandmark + (long long)t * numLandmarks;
+        const int* toV = toLandmark + (long long)v * numLandmarks;
+        const int* toT = toLandmark + (long long)t * numLandmarks;
+        int best = 0;
+        for (int k = 0; k < numLandmarks; ++k) {
+            // an unreachable side gives no information
+            if (fromT[k] != INF && fromV[k] != INF && fromT[k] - fromV[k] > best) best = fromT[k] - fromV[k];
+            if (toV[k] != INF && toT[k] != INF && toV[k] - toT[k] > best) best = toV[k] - toT[k];
+        }
+        return best;
+    }
+
+    long long memoryBytes() const {
+        return 2LL * numVertices * numLandmarks * sizeof(int) + numLandmarks * sizeof(int);
+    }
+
+    // Binary layout: magic, version, vertices, edges, node order, landmarks,
+    // the edge hash, then the landmark ids and both tables. The graph size,
+    // numbering and edge hash are checked on load, so tables built for other
+    // weights are rejected.
+    bool save(const char* filename) const {
+        ofstream out(filename, ios::binary);
+        if (!out.is_open()) return false;
+        int header[6] = {LANDMARK_MAGIC, LANDMARK_VERSION, numVertices, numEdges, nodeOrder, numLandmarks};
+        out.write((const char*)header, sizeof(header));
+        out.write((const char*)&edgeHash, sizeof(edgeHash));
+        out.write((const char*)landmarks, numLandmarks * sizeof(int));
+        out.write((const char*)fromLandmark, (long long)numVertices * numLandmarks * sizeof(int));
+        out.write((const char*)toLandmark, (long long)numVertices * numLandmarks * sizeof(int));
+        return out.good();
+    }
+    bool load(const char* filename, ManualGraph* graph) {
+        ifstream in(filename, ios::binary);
+        if (!in.is_open()) return false;
+        int header[6];
+        unsigned long long hash = 0;
+        in.read((char*)header, sizeof(header));
+        in.read((char*)&hash, sizeof(hash));
+        if (!in || header[0] != LANDMARK_MAGIC || header[1] != LANDMARK_VERSION ||
+            header[2] != graph->numVertices || header[3] != graph->numEdges ||
+            header[4] != graph->nodeOrder || header[5] <= 0 || hash != graph->edgeHash()) {
+            return false;
+        }
+        int* ids = new int[header[5]];
+        int* from = new int[(long long)header[2] * header[5]];
+        int* to = new int[(long long)header[2] * header[5]];
+        in.read((char*)ids, header[5] * sizeof(int));
+        in.read((char*)from, (long long)header[2] * header[5] * sizeof(int));
+        in.read((char*)to, (long long)header[2] * header[5] * sizeof(int));
+        if (!in) {
+            delete[] ids;
+            delete[] from;
+            delete[] to;
+            return false;
+        }
+        delete[] landmarks;
+        delete[] fromLandmark;
+        delete[] toLandmark;
+        numVertices = header[2];
+        numEdges = header[3];
+        nodeOrder = header[4];
+        numLandmarks = header[5];
+        edgeHash = hash;
+        landmarks = ids;
+        fromLandmark = from;
+        toLandmark = to;
+        return true;
+    }
+
+private:
+    static const int LANDMARK_MAGIC = 0x4d4c4650; // "PFLM"
+    static const int LANDMARK_VERSION = 3;
+
+    void compact(int rowWidth) {
+        if (rowWidth == numLandmarks) return;
+        for (int v = 0; v < numVertices; ++v) {
+            for (int k = 0; k < numLandmarks; ++k) {
+                fromLandmark[(long long)v * numLandmarks + k] = fromLandmark[(long long)v * rowWidth + k];
+                toLandmark[(long long)v * numLandmarks + k] = toLandmark[(long long)v * rowWidth + k];
+            }
+        }
+    }
+};
+
+
+
+// Lower bound on the remaining weight from node v to the nearest end door,
+// from the landmark tables when given, otherwise from the coordinates.
+int estimateRemaining(ManualGraph* graph, const LandmarkTable* landmarks, int v,
+                      const int* endIndices, int numEnds, int* heuristic) {
+    if (heuristic[v] != -1) return heuristic[v];
+    if (landmarks != nullptr) {
+        int bound = INF;
+        for (int t = 0; t < numEnds; ++t) {
+            int b = landmarks->lowerBound(v, endIndices[t]);
+            if (b < bound) bound = b;
+        }
+        heuristic[v] = numEnds > 0 ? bound : 0;
+        return heuristic[v];
+    }
+    double best = -1.0;
+    for (int t = 0; t < numEnds; ++t) {
+        double d = graph->pixelDistance(v, endIndices[t]);
+        if (best < 0.0 || d < best) best = d;
+    }
+    heuristic[v] = best > 0.0 ? (int)floor(best * graph->heuristicScale) : 0;
+    return heuristic[v];
+}
+
+// A* search guided by the node x/y coordinates. The heuristic is the pixel
+// distance to the closest end door times graph->heuristicScale, so it returns
+// the same distance as dijkstra() while settling fewer nodes. Passing a
+// LandmarkTable switches to the ALT bounds instead.
+void aStarMulti(ManualGraph* graph, const int* startIndices, int numStarts,
+                const int* endIndices, int numEnds, PathResult& result, SearchWorkspace& workspace,
+                const LandmarkTable* landmarks = nullptr) {
+    workspace.prepare(graph->numVertices);
+    SearchSide& side = workspace.forward;
+    int* heuristic = side.extra; // lazily filled, -1 = not computed yet
+    MinPriorityQueue& pq = *workspace.heapF;
+    side.reset();
+    pq.clear();
+
+    for (int s = 0; s < numStarts; ++s) {
+        int startIndex = startIndices[s];
+        if (side.dist(startIndex) == 0) continue;
+        if (!side.reached(startIndex)) heuristic[startIndex] = -1;
+        side.set(startIndex, 0, -1, startIndex);
+        pq.insert(startIndex, estimateRemaining(graph, landmarks, startIndex, endIndices, numEnds, heuristic));
+    }
+
+    int reached = -1;
+    int settled = 0;
+    while (!pq.isEmpty()) {
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+
+        // queue key is g + h, skip entries that were improved later
+        if (minNode.distance - heuristic[u] > side.dist(u)) {
+            continue;
+        }
+        settled++;
+
+        bool isEnd = false;
+        for (int t = 0; t < numEnds; ++t) {
+            if (endIndices[t] == u) {
+                isEnd = true;
+                break;
+            }
+        }
+        if (isEnd) {
+            reached = u;
+            break;
+        }
+
+        const EdgeArrays& edges = graph->outEdges;
+        for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+            int v = edges.target(e);
+            int newDist = side.dist(u) + edges.weight(e);
+            if (newDist < side.dist(v)) {
+                if (!side.reached(v)) heuristic[v] = -1;
+                side.set(v, newDist, u, side.origin[u]);
+                pq.insert(v, newDist + estimateRemaining(graph, landmarks, v, endIndices, numEnds, heuristic));
+            }
+        }
+    }
+
+    result.settled = settled;
+    if (reached != -1) {
+        result.distance = side.dist(reached);
+        result.previous = side.parent;
+        result.startIndex = side.origin[reached];
+        result.endIndex = reached;
+    } else {
+        result.distance = INF;
+        result.previous = nullptr;
+    }
+}
+
+
+
+// Bidirectional Dijkstra: a forward frontier grows from the start doors over
+// outEdges and a backward frontier grows from the end doors over
+// inEdges. The search stops once the two queue minima add up to the
+// best meeting distance found so far.
+void bidirectionalDijkstra(ManualGraph* graph, const int* startIndices, int numStarts,
+                           const int* endIndices, int numEnds, PathResult& result, SearchWorkspace& workspace) {
+    workspace.prepare(graph->numVertices);
+    SearchSide& sideF = workspace.forward;  // parents are handed to 'result'
+    SearchSide& sideB = workspace.backward; // parents point towards the end doors
+    MinPriorityQueue& pqF = *workspace.heapF;
+    MinPriorityQueue& pqB = *workspace.heapB;
+    sideF.reset();
+    sideB.reset();
+    pqF.clear();
+    pqB.clear();
+
+    int best = INF;
+    int meet = -1;
+    for (int s = 0; s < numStarts; ++s) {
+        int u = startIndices[s];
+        if (sideF.dist(u) == 0) continue;
+        sideF.set(u, 0, -1, u);
+        pqF.insert(u, 0);
+    }
+    for (int t = 0; t < numEnds; ++t) {
+        int u = endIndices[t];
+        if (sideB.dist(u) == 0) continue;
+        sideB.set(u, 0, -1, u);
+        pqB.insert(u, 0);
+        if (sideF.dist(u) == 0) { // start and end share a door
+            best = 0;
+            meet = u;
+        }
+    }
+
+    int settled = 0;
+    while (!pqF.isEmpty() && !pqB.isEmpty()) {
+        int topF = pqF.minDistance();
+        int topB = pqB.minDistance();
+        if ((long long)topF + topB >= best) {
+            break;
+        }
+
+        // expand the side with the smaller frontier key
+        bool forward = topF <= topB;
+        MinPriorityQueue& pq = forward ? pqF : pqB;
+        SearchSide& side = forward ? sideF : sideB;
+        SearchSide& other = forward ? sideB : sideF;
+        const EdgeArrays& edges = forward ? graph->outEdges : graph->inEdges;
+
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+        if (minNode.distance > side.dist(u)) {
+            continue;
+        }
+        settled++;
+
+        for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+            int v = edges.target(e);
+            int newDist = side.dist(u) + edges.weight(e);
+            if (newDist < side.dist(v)) {
+                side.set(v, newDist, u, side.origin[u]);
+                pq.insert(v, newDist);
+            }
+            int otherDist = other.dist(v);
+            if (otherDist != INF && (long long)side.dist(v) + otherDist < best) {
+                best = side.dist(v) + otherDist;
+                meet = v;
+            }
+        }
+    }
+
+    result.settled = settled;
+    if (meet != -1) {
+        // splice the backward half onto the forward parents so the caller can
+        // walk 'previous' from the end door exactly like a dijkstra() result
+        int* previous = sideF.parent;
+        int current = meet;
+        while (sideB.parent[current] != -1) {
+            int next = sideB.parent[current];
+            previous[next] = current;
+            current = next;
+        }
+        result.distance = best;
+        result.previous = previous;
+        result.startIndex = sideF.origin[meet];
+        result.endIndex = sideB.origin[meet];
+    } else {
+        result.distance = INF;
+        result.previous = nullptr;
+    }
+}
+
+
+
+// Contraction Hierarchies
+// Nodes are contracted one by one in order of edge difference (shortcuts added
+// minus edges removed), plus the number of already contracted neighbours and
+// the node's level in the hierarchy so far, which keeps the ordering uniform.
+// Every arc of the overlay graph, original or shortcut, lives in one pool so a
+// shortcut can be unpacked through its two child arcs.
+struct CHArc {
+    int from;
+    int to;
+    int weight;
+    int childA; // first half of a shortcut (from -> middle), -1 for original edges
+    int childB; // second half (middle -> to)
+    int nextOut; // next arc leaving 'from' (overlay lists during contraction)
+    int nextIn;  // next arc entering 'to'
+};
+
+class ContractionHierarchy {
+private:
+    int numVertices;
+    CHArc* arcs;
+    int numArcs;
+    int arcCapacity;
+    int* outHead;
+    int* inHead;
+    bool* contracted;
+    int* deletedNeighbors;
+    int* level;
+
+    // witness search scratch, reset lazily through the stamp
+    int* witnessDist;
+    int* witnessStamp;
+    int* targetStamp; // marks the out-neighbours the current witness search must reach
+    int currentStamp;
+    MinPriorityQueue* witnessQueue;
+
+    // upward search graph in CSR form: arcs to higher ranked nodes for the
+    // forward search, and reversed arcs to higher ranked nodes for the backward search
+    int* upFirst;
+    int* upTarget;
+    int* upWeight;
+    int* upArc;
+    int* downFirst;
+    int* downTarget;
+    int* downWeight;
+    int* downArc;
+
+    // witness searches give up after this many settled nodes; a cheaper limit
+    // is enough while only estimating priorities
+    static const int WITNESS_SETTLE_LIMIT = 200;
+    static const int SIMULATE_SETTLE_LIMIT = 15;
+
+    int addArc(int from, int to, int weight, int childA, int childB) {
+        if (numArcs == arcCapacity) {
+            arcCapacity *= 2;
+            CHArc* grown = new CHArc[arcCapacity];
+            for (int i = 0; i < numArcs; ++i) grown[i] = arcs[i];
+            delete[] arcs;
+            arcs = grown;
+        }
+        CHArc& arc = arcs[numArcs];
+        arc.from = from;
+        arc.to = to;
+        arc.weight = weight;
+        arc.childA = childA;
+        arc.childB = childB;
+        arc.nextOut = outHead[from];
+        arc.nextIn = inHead[to];
+        outHead[from] = numArcs;
+        inHead[to] = numArcs;
+        return numArcs++;
+    }
+
+    // Local Dijkstra from 'source' that avoids 'skip' and contracted nodes and
+    // gives up beyond 'limit', after 'settleLimit' nodes or once all 'targets'
+    // marked in targetStamp are settled. Unsettled nodes keep INF or an upper
+    // bound, which can only cause an unneeded shortcut, never a wrong distance.
+    void witnessSearch(int source, int skip, int limit, int settleLimit, int targets) {
+        witnessQueue->clear();
+        witnessDist[source] = 0;
+        witnessStamp[source] = currentStamp;
+        witnessQueue->insert(source, 0);
+        int settled = 0;
+        while (!witnessQueue->isEmpty()) {
+            HeapNode minNode = witnessQueue->extractMin();
+            int u = minNode.nodeIndex;
+            if (minNode.distance > witnessDist[u]) continue;
+            if (minNode.distance > limit || ++settled > settleLimit) break;
+            if (targetStamp[u] == currentStamp && --targets == 0) break;
+            for (int a = outHead[u]; a != -1; a = arcs[a].nextOut) {
+                int v = arcs[a].to;
+                if (v == skip || contracted[v]) continue;
+                int newDist = minNode.distance + arcs[a].weight;
+                if (witnessStamp[v] != currentStamp || newDist < witnessDist[v]) {
+                    witnessStamp[v] = currentStamp;
+                    witnessDist[v] = newDist;
+                    witnessQueue->insert(v, newDist);
+                }
+            }
+        }
+    }
+
+    int witnessDistance(int v) {
+        return witnessStamp[v] == currentStamp ? witnessDist[v] : INF;
+    }
+
+    // Adds the shortcuts needed to remove 'v' (or only counts them when
+    // simulating) and returns how many there are.
+    int contractNode(int v, bool simulate) {
+        int shortcuts = 0;
+        for (int in = inHead[v]; in != -1; in = arcs[in].nextIn) {
+            int u = arcs[in].from;
+            if (u == v || contracted[u]) continue;
+            int w1 = arcs[in].weight;
+
+            currentStamp++;
+            int limit = 0;
+            int targets = 0;
+            for (int out = outHead[v]; out != -1; out = arcs[out].nextOut) {
+                int x = arcs[out].to;
+                if (x == u || x == v || contracted[x]) continue;
+                if (w1 + arcs[out].weight > limit) limit = w1 + arcs[out].weight;
+                if (targetStamp[x] != currentStamp) {
+                    targetStamp[x] = currentStamp;
+                    targets++;
+                }
+            }
+            if (targets == 0) continue;
+            witnessSearch(u, v, limit, simulate ? SIMULATE_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT, targets);
+
+            for (int out = outHead[v]; out != -1; out = arcs[out].nextOut) {
+                int x = arcs[out].to;
+                if (x == u || x == v || contracted[x]) continue;
+                int viaV = w1 + arcs[out].weight;
+                if (witnessDistance(x) <= viaV) continue;
+                shortcuts++;
+                if (!simulate) {
+                    addArc(u, x, viaV, in, out);
+                }
+            }
+        }
+        return shortcuts;
+    }
+
+    // Unlinks arcs to contracted nodes from the overlay lists of 'v' so later
+    // witness searches and priority updates only walk live arcs. The arcs
+    // stay in the pool for the search graph and for unpacking.
+    void dropContractedArcs(int v) {
+        int* link = &outHead[v];
+        while (*link != -1) {
+            if (contracted[arcs[*link].to]) *link = arcs[*link].nextOut;
+            else link = &arcs[*link].nextOut;
+        }
+        link = &inHead[v];
+        while (*link != -1) {
+            if (contracted[arcs[*link].from]) *link = arcs[*link].nextIn;
+            else link = &arcs[*link].nextIn;
+        }
+    }
+
+    int priority(int v) {
+        int removed = 0;
+        for (int a = inHead[v]; a != -1; a = arcs[a].nextIn) {
+            if (!contracted[arcs[a].from]) removed++;
+        }
+        for (int a = outHead[v]; a != -1; a = arcs[a].nextOut) {
+            if (!contracted[arcs[a].to]) removed++;
+        }
+        return 2 * (contractNode(v, true) - removed) + deletedNeighbors[v] + level[v];
+    }
+
+    void buildSearchGraph() {
+        upFirst = new int[numVertices + 1];
+        downFirst = new int[numVertices + 1];
+        for (int i = 0; i <= numVertices; ++i) {
+            upFirst[i] = 0;
+            downFirst[i] = 0;
+        }
+        for (int a = 0; a < numArcs; ++a) {
+            if (rank[arcs[a].from] < rank[arcs[a].to]) upFirst[arcs[a].from + 1]++;
+            else downFirst[arcs[a].to + 1]++;
+        }
+        for (int i = 0; i < numVertices; ++i) {
+            upFirst[i + 1] += upFirst[i];
+            downFirst[i + 1] += downFirst[i];
+        }
+        upTarget = new int[upFirst[numVertices]];
+        upWeight = new int[upFirst[numVertices]];
+        upArc = new int[upFirst[numVertices]];
+        downTarget = new int[downFirst[numVertices]];
+        downWeight = new int[downFirst[numVertices]];
+        downArc = new int[downFirst[numVertices]];
+        int* upFill = new int[numVertices];
+        int* downFill = new int[numVertices];
+        for (int i = 0; i < numVertices; ++i) {
+            upFill[i] = upFirst[i];
+            downFill[i] = downFirst[i];
+        }
+        for (int a = 0; a < numArcs; ++a) {
+            int from = arcs[a].from;
+            int to = arcs[a].to;
+            if (rank[from] < rank[to]) {
+                int slot = upFill[from]++;
+                upTarget[slot] = to;
+                upWeight[slot] = arcs[a].weight;
+                upArc[slot] = a;
+            } else {
+                int slot = downFill[to]++;
+                downTarget[slot] = from;
+                downWeight[slot] = arcs[a].weight;
+                downArc[slot] = a;
+            }
+        }
+        delete[] upFill;
+        delete[] downFill;
+    }
+
+public:
+    int* rank; // contraction position of every node
+    int numOriginalEdges;
+    int numShortcuts;
+    double preprocessMillis;
+
+    ContractionHierarchy(ManualGraph* graph) : numVertices(graph->numVertices), numArcs(0),
+        currentStamp(0), numOriginalEdges(0), numShortcuts(0), preprocessMillis(0.0) {
+        auto startTime = chrono::steady_clock::now();
+
+        arcCapacity = 16;
+        arcs = new CHArc[arcCapacity];
+        outHead = new int[numVertices];
+        inHead = new int[numVertices];
+        contracted = new bool[numVertices];
+        deletedNeighbors = new int[numVertices];
+        level = new int[numVertices];
+        witnessDist = new int[numVertices];
+        witnessStamp = new int[numVertices];
+        targetStamp = new int[numVertices];
+        rank = new int[numVertices];
+        for (int i = 0; i < numVertices; ++i) {
+            outHead[i] = -1;
+            inHead[i] = -1;
+            contracted[i] = false;
+            deletedNeighbors[i] = 0;
+            level[i] = 0;
+            witnessStamp[i] = 0;
+            targetStamp[i] = 0;
+            rank[i] = -1;
+        }
+        witnessQueue = new MinPriorityQueue(numVertices);
+
+        for (int u = 0; u < numVertices; ++u) {
+            for (int e = graph->outEdges.begin[u]; e < graph->outEdges.end[u]; ++e) {
+                int v = graph->outEdges.target(e);
+                if (v == u) continue; // self loops never help a shortest path
+                addArc(u, v, graph->outEdges.weight(e), -1, -1);
+            }
+        }
+        numOriginalEdges = numArcs;
+
+        // node ordering with lazy updates: a popped node is re-evaluated and
+        // only contracted if it is still no worse than the next candidate
+        int* currentPriority = new int[numVertices];
+        MinPriorityQueue order(numVertices);
+        for (int v = 0; v < numVertices; ++v) {
+            currentPriority[v] = priority(v);
+            order.insert(v, currentPriority[v]);
+        }
+        int nextRank = 0;
+        while (!order.isEmpty()) {
+            HeapNode top = order.extractMin();
+            int v = top.nodeIndex;
+            if (contracted[v] || top.distance != currentPriority[v]) continue;
+            int updated = priority(v);
+            if (updated > order.minDistance()) {
+                currentPriority[v] = updated;
+                order.insert(v, updated);
+                continue;
+            }
+            int before = numArcs;
+            contractNode(v, false);
+            numShortcuts += numArcs - before;
+            contracted[v] = true;
+            rank[v] = nextRank++;
+
+            for (int a = outHead[v]; a != -1; a = arcs[a].nextOut) {
+                int x = arcs[a].to;
+                if (!contracted[x]) dropContractedArcs(x);
+            }
+            for (int a = inHead[v]; a != -1; a = arcs[a].nextIn) {
+                int u = arcs[a].from;
+                if (!contracted[u]) dropContractedArcs(u);
+            }
+            for (int a = outHead[v]; a != -1; a = arcs[a].nextOut) {
+                int x = arcs[a].to;
+                if (contracted[x]) continue;
+                deletedNeighbors[x]++;
+                if (level[v] + 1 > level[x]) level[x] = level[v] + 1;
+                currentPriority[x] = priority(x);
+                order.insert(x, currentPriority[x]);
+            }
+            for (int a = inHead[v]; a != -1; a = arcs[a].nextIn) {
+                int u = arcs[a].from;
+                if (contracted[u]) continue;
+                deletedNeighbors[u]++;
+                if (level[v] + 1 > level[u]) level[u] = level[v] + 1;
+                currentPriority[u] = priority(u);
+                order.insert(u, currentPriority[u]);
+            }
+        }
+        delete[] currentPriority;
+
+        buildSearchGraph();
+        preprocessMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+    ~ContractionHierarchy() {
+        delete[] arcs;
+        delete[] outHead;
+        delete[] inHead;
+        delete[] contracted;
+        delete[] deletedNeighbors;
+        delete[] level;
+        delete[] witnessDist;
+        delete[] witnessStamp;
+        delete[] targetStamp;
+        delete witnessQueue;
+        delete[] upFirst;
+        delete[] upTarget;
+        delete[] upWeight;
+        delete[] upArc;
+        delete[] downFirst;
+        delete[] downTarget;
+        delete[] downWeight;
+        delete[] downArc;
+        delete[] rank;
+    }
+
+    // Upward search from the start doors and backward upward search from the
+    // end doors; the best meeting node is then unpacked into original edges
+    // and written to 'previous' like a dijkstra() result.
+    void query(const int* startIndices, int numStarts, const int* endIndices, int numEnds,
+               PathResult& result, SearchWorkspace& workspace) {
+        workspace.prepare(numVertices);
+        SearchSide& sideF = workspace.forward;  // parent = arc used to reach a node
+        SearchSide& sideB = workspace.backward; // parent = arc leaving a node towards the end
+        MinPriorityQueue& pqF = *workspace.heapF;
+        MinPriorityQueue& pqB = *workspace.heapB;
+        sideF.reset();
+        sideB.reset();
+        pqF.clear();
+        pqB.clear();
+        for (int s = 0; s < numStarts; ++s) {
+            sideF.set(startIndices[s], 0, -1, -1);
+            pqF.insert(startIndices[s], 0);
+        }
+        for (int t = 0; t < numEnds; ++t) {
+            sideB.set(endIndices[t], 0, -1, -1);
+            pqB.insert(endIndices[t], 0);
+        }
+
+        int best = INF;
+        int meet = -1;
+        int settled = 0;
+        // unlike plain bidirectional Dijkstra each side must run until its own
+        // minimum passes the best distance, the meeting node is the top of the path
+        while (!pqF.isEmpty() || !pqB.isEmpty()) {
+            bool forward;
+            if (pqF.isEmpty()) forward = false;
+            else if (pqB.isEmpty()) forward = true;
+            else forward = pqF.minDistance() <= pqB.minDistance();
+
+            MinPriorityQueue& pq = forward ? pqF : pqB;
+            if (pq.minDistance() >= best) {
+                pq.clear();
+                continue;
+            }
+            SearchSide& side = forward ? sideF : sideB;
+            SearchSide& other = forward ? sideB : sideF;
+            int* first = forward ? upFirst : downFirst;
+            int* target = forward ? upTarget : downTarget;
+            int* weight = forward ? upWeight : downWeight;
+            int* arcId = forward ? upArc : downArc;
+
+            HeapNode minNode = pq.extractMin();
+            int u = minNode.nodeIndex;
+            if (minNode.distance > side.dist(u)) continue;
+            settled++;
+            int otherDist = other.dist(u);
+            if (otherDist != INF && side.dist(u) + otherDist < best) {
+                best = side.dist(u) + otherDist;
+                meet = u;
+            }
+            for (int i = first[u]; i < first[u + 1]; ++i) {
+                int v = target[i];
+                int newDist = side.dist(u) + weight[i];
+                if (newDist < side.dist(v)) {
+                    side.set(v, newDist, arcId[i], -1);
+                    pq.insert(v, newDist);
+                }
+            }
+        }
+
+        result.settled = settled;
+        if (meet == -1) {
+            result.distance = INF;
+            result.previous = nullptr;
+            return;
+        }
+        int* previous = workspace.path;
+
+        // collect the up/down arc chain in path order on a stack
+        IntStack& chain = workspace.chain;
+        chain.size = 0;
+        for (int v = meet; sideB.parent[v] != -1; v = arcs[sideB.parent[v]].to) {
+            chain.push(sideB.parent[v]);
+        }
+        IntStack& ordered = workspace.ordered; // reversed again below, end of path ends up at the bottom
+        ordered.size = 0;
+        while (!chain.isEmpty()) ordered.push(chain.pop());
+        for (int v = meet; sideF.parent[v] != -1; v = arcs[sideF.parent[v]].from) {
+            ordered.push(sideF.parent[v]);
+        }
+
+        // unpack shortcuts depth first, left half before right half
+        bool firstEdge = true;
+        while (!ordered.isEmpty()) {
+            int a = ordered.pop();
+            if (arcs[a].childA != -1) {
+                ordered.push(arcs[a].childB);
+                ordered.push(arcs[a].childA);
+                continue;
+            }
+            if (firstEdge) {
+                workspace.extendRoute(arcs[a].from);
+                firstEdge = false;
+            }
+            workspace.extendRoute(arcs[a].to);
+        }
+        if (firstEdge) workspace.extendRoute(meet);
+        int startIndex, endIndex;
+        workspace.finishRoute(startIndex, endIndex);
+
+        result.distance = best;
+        result.previous = previous;
+        result.startIndex = startIndex;
+        result.endIndex = endIndex;
+    }
+};
+
+
+
+// All-pairs distance and next-hop tables. Column t holds d(v, t) and the
+// next node from v towards t, filled by one backward search per target, so a
+// path is read off by following next hops inside one contiguous column.
+// Targets are spread over all hardware threads.
+class DistanceTable {
+public:
+    int numVertices;
+    int* distances; // distances[t * numVertices + v] = d(v, t)
+    int* nextHop;   // nextHop[t * numVertices + v]   = next node after v on the way to t
+    double preprocessMillis;
+    int threadsUsed;
+
+    DistanceTable(ManualGraph* graph) : numVertices(graph->numVertices), preprocessMillis(0.0), threadsUsed(1) {
+        auto startTime = chrono::steady_clock::now();
+        long long cells = (long long)numVertices * numVertices;
+        distances = new int[cells];
+        nextHop = new int[cells];
+
+        int threads = (int)thread::hardware_concurrency();
+        if (threads < 1) threads = 1;
+        if (threads > numVertices) threads = numVertices > 0 ? numVertices : 1;
+        threadsUsed = threads;
+
+        atomic<int> nextTarget(0);
+        auto worker = [&]() {
+            int t;
+            while ((t = nextTarget.fetch_add(1)) < numVertices) {
+                long long column = (long long)t * numVertices;
+                singleSourceDistances(graph, t, true, distances + column, nextHop + column);
+            }
+        };
+        thread* pool = new thread[threads - 1];
+        for (int i = 0; i < threads - 1; ++i) pool[i] = thread(worker);
+        worker();
+        for (int i = 0; i < threads - 1; ++i) pool[i].join();
+        delete[] pool;
+
+        preprocessMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+    ~DistanceTable() {
+        delete[] distances;
+        delete[] nextHop;
+    }
+
+    int distance(int s, int t) const {
+        return distances[(long long)t * numVertices + s];
+    }
+
+    long long memoryBytes() const {
+        return 2LL * numVertices * numVertices * sizeof(int);
+    }
+
+    // Picks the closest door pair by lookup and walks the next hops to fill
+    // 'previous' like a dijkstra() result.
+    void query(const int* startIndices, int numStarts, const int* endIndices, int numEnds,
+               PathResult& result, SearchWorkspace& workspace) {
+        int bestStart = -1;
+        int bestEnd = -1;
+        int best = INF;
+        for (int s = 0; s < numStarts; ++s) {
+            for (int t = 0; t < numEnds; ++t) {
+                int d = distance(startIndices[s], endIndices[t]);
+                if (d < best) {
+                    best = d;
+                    bestStart = startIndices[s];
+                    bestEnd = endIndices[t];
+                }
+            }
+        }
+        result.settled = 0;
+        if (bestStart == -1) {
+            result.distance = INF;
+            result.previous = nullptr;
+            return;
+        }
+        workspace.prepare(numVertices);
+        int* previous = workspace.path;
+        const int* column = nextHop + (long long)bestEnd * numVertices;
+        for (int v = bestStart; v != bestEnd; v = column[v]) {
+            previous[column[v]] = v;
+        }
+        result.distance = best;
+        result.previous = previous;
+        result.startIndex = bestStart;
+        result.endIndex = bestEnd;
+    }
+};
+
+
+
+// Hub labels (2-hop cover) built with pruned landmark labeling. Every node v
+// keeps an out label {(h, d(v, h))} and an in label {(h, d(h, v))}; for any
+// pair some hub on a shortest path is in both, so d(s, t) is the minimum of
+// out(s)[h] + in(t)[h] over the common hubs. Hubs are numbered by processing
+// rank and every label is a flat run sorted by rank with an INF sentinel, so
+// a query is one merge over two contiguous int arrays. The parent stored with
+// each entry (next node towards the hub, or previous node from it) is enough
+// to rebuild the path, since pruned searches only grow from labeled nodes.
+class HubLabels {
+private:
+    struct LabelList {
+        int* hub;
+        int* dist;
+        int* parent;
+        int size;
+        int capacity;
+    };
+
+    static void push(LabelList& list, int hub, int dist, int parent) {
+        if (list.size == list.capacity) {
+            int capacity = list.capacity == 0 ? 4 : list.capacity * 2;
+            int* hubs = new int[capacity];
+            int* dists = new int[capacity];
+            int* parents = new int[capacity];
+            for (int i = 0; i < list.size; ++i) {
+                hubs[i] = list.hub[i];
+                dists[i] = list.dist[i];
+                parents[i] = list.parent[i];
+            }
+            delete[] list.hub;
+            delete[] list.dist;
+            delete[] list.parent;
+            list.hub = hubs;
+            list.dist = dists;
+            list.parent = parents;
+            list.capacity = capacity;
+        }
+        list.hub[list.size] = hub;
+        list.dist[list.size] = dist;
+        list.parent[list.size] = parent;
+        list.size++;
+    }
+
+    // One pruned Dijkstra from the hub of rank 'h'. 'hubLabel' is the label
+    // of the hub itself on the opposite side, spread into 'hubDist' by rank.
+    void prunedSearch(ManualGraph* graph, int h, bool backward, LabelList* labels,
+                      int* dist, int* parent, int* stamp, int currentStamp, int* hubDist,
+                      MinPriorityQueue& pq) {
+        int root = order[h];
+        const EdgeArrays& edges = backward ? graph->inEdges : graph->outEdges;
+        pq.clear();
+        dist[root] = 0;
+        parent[root] = -1;
+        stamp[root] = currentStamp;
+        pq.insert(root, 0);
+        while (!pq.isEmpty()) {
+            HeapNode minNode = pq.extractMin();
+            int u = minNode.nodeIndex;
+            if (minNode.distance > dist[u]) continue;
+
+            // prune when the labels built so far already cover this distance
+            LabelList& label = labels[u];
+            bool covered = false;
+            for (int i = 0; i < label.size; ++i) {
+                int viaHub = hubDist[label.hub[i]];
+                if (viaHub != INF && viaHub + label.dist[i] <= minNode.distance) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) continue;
+            push(label, h, minNode.distance, parent[u]);
+
+            for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+                int v = edges.target(e);
+                int newDist = minNode.distance + edges.weight(e);
+                if (stamp[v] != currentStamp || newDist < dist[v]) {
+                    stamp[v] = currentStamp;
+                    dist[v] = newDist;
+                    parent[v] = u;
+                    pq.insert(v, newDist);
+                }
+            }
+        }
+    }
+
+    static void flatten(LabelList* lists, int numVertices, int*& offset, int*& hub, int*& dist, int*& parent) {
+        offset = new int[numVertices + 1];
+        offset[0] = 0;
+        for (int v = 0; v < numVertices; ++v) {
+            offset[v + 1] = offset[v] + lists[v].size + 1; // +1 for the sentinel
+        }
+        hub = new int[offset[numVertices]];
+        dist = new int[offset[numVertices]];
+        parent = new int[offset[numVertices]];
+        for (int v = 0; v < numVertices; ++v) {
+            int at = offset[v];
+            for (int i = 0; i < lists[v].size; ++i) {
+                hub[at + i] = lists[v].hub[i];
+                dist[at + i] = lists[v].dist[i];
+                parent[at + i] = lists[v].parent[i];
+            }
+            hub[offset[v + 1] - 1] = INF;
+            dist[offset[v + 1] - 1] = INF;
+            parent[offset[v + 1] - 1] = -1;
+            delete[] lists[v].hub;
+            delete[] lists[v].dist;
+            delete[] lists[v].parent;
+        }
+    }
+
+    // index of the entry for hub 'h' in the sorted label run [begin, end)
+    static int findEntry(const int* hubs, int begin, int end, int h) {
+        int lo = begin;
+        int hi = end;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (hubs[mid] < h) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+public:
+    int numVertices;
+    int* order;  // order[rank] = node
+    int* outOffset;
+    int* outHub;
+    int* outDist;
+    int* outParent; // next node from v towards the hub
+    int* inOffset;
+    int* inHub;
+    int* inDist;
+    int* inParent;  // node before v on the way from the hub
+    double preprocessMillis;
+
+    HubLabels(ManualGraph* graph) : numVertices(graph->numVertices), preprocessMillis(0.0) {
+        auto startTime = chrono::steady_clock::now();
+        int V = numVertices;
+
+        // Hubs go from most to least important: reverse contraction order when a
+        // hierarchy exists (much smaller labels on road-like graphs), otherwise
+        // decreasing degree so central junctions cover most pairs.
+        order = new int[V];
+        int* importance = new int[V];
+        for (int v = 0; v < V; ++v) {
+            importance[v] = 0;
+            if (graph->ch != nullptr) {
+                importance[v] = graph->ch->rank[v];
+                continue;
+            }
+            importance[v] = graph->outEdges.end[v] - graph->outEdges.begin[v] +
+                            graph->inEdges.end[v] - graph->inEdges.begin[v];
+        }
+        MinPriorityQueue byImportance(V);
+        for (int v = 0; v < V; ++v) byImportance.insert(v, -importance[v]);
+        for (int r = 0; r < V; ++r) order[r] = byImportance.extractMin().nodeIndex;
+        delete[] importance;
+
+        LabelList* outLists = new LabelList[V];
+        LabelList* inLists = new LabelList[V];
+        for (int v = 0; v < V; ++v) {
+            outLists[v] = {nullptr, nullptr, nullptr, 0, 0};
+            inLists[v] = {nullptr, nullptr, nullptr, 0, 0};
+        }
+        int* dist = new int[V];
+        int* parent = new int[V];
+        int* stamp = new int[V];
+        int* hubDist = new int[V]; // by hub rank
+        for (int i = 0; i < V; ++i) {
+            stamp[i] = 0;
+            hubDist[i] = INF;
+        }
+        MinPriorityQueue pq(V);
+        int currentStamp = 0;
+        for (int h = 0; h < V; ++h) {
+            int root = order[h];
+
+            // forward search fills in labels, pruned with out(root)
+            LabelList& rootOut = outLists[root];
+            for (int i = 0; i < rootOut.size; ++i) hubDist[rootOut.hub[i]] = rootOut.dist[i];
+            hubDist[h] = 0;
+            prunedSearch(graph, h, false, inLists, dist, parent, stamp, ++currentStamp, hubDist, pq);
+            for (int i = 0; i < rootOut.size; ++i) hubDist[rootOut.hub[i]] = INF;
+
+            // backward search fills out labels, pruned with in(root)
+            LabelList& rootIn = inLists[root];
+            for (int i = 0; i < rootIn.size; ++i) hubDist[rootIn.hub[i]] = rootIn.dist[i];
+            hubDist[h] = 0;
+            prunedSearch(graph, h, true, outLists, dist, parent, stamp, ++currentStamp, hubDist, pq);
+            for (int i = 0; i < rootIn.size; ++i) hubDist[rootIn.hub[i]] = INF;
+            hubDist[h] = INF;
+        }
+        delete[] dist;
+        delete[] parent;
+        delete[] stamp;
+        delete[] hubDist;
+
+        flatten(outLists, V, outOffset, outHub, outDist, outParent);
+        flatten(inLists, V, inOffset, inHub, inDist, inParent);
+        delete[] outLists;
+        delete[] inLists;
+        preprocessMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+    }
+    ~HubLabels() {
+        delete[] order;
+        delete[] outOffset;
+        delete[] outHub;
+        delete[] outDist;
+        delete[] outParent;
+        delete[] inOffset;
+        delete[] inHub;
+        delete[] inDist;
+        delete[] inParent;
+    }
+
+    // Merge of out(s) and in(t); returns d(s, t) and the rank of the best hub.
+    int distance(int s, int t, int& bestHub) const {
+        const int* a = outHub + outOffset[s];
+        const int* b = inHub + inOffset[t];
+        const int* da = outDist + outOffset[s];
+        const int* db = inDist + inOffset[t];
+        int best = INF;
+        bestHub = -1;
+        int i = 0;
+        int j = 0;
+        while (true) {
+            int ha = a[i];
+            int hb = b[j];
+            if (ha == hb) {
+                if (ha == INF) break;
+                int d = da[i] + db[j];
+                if (d < best) {
+                    best = d;
+                    bestHub = ha;
+                }
+                i++;
+                j++;
+            } else {
+                // branch free advance of the smaller side
+                i += ha < hb;
+                j += hb < ha;
+            }
+        }
+        return best;
+    }
+
+    long long totalEntries() const {
+        return (long long)outOffset[numVertices] + inOffset[numVertices] - 2LL * numVertices;
+    }
+    int maxLabelSize() const {
+        int best = 0;
+        for (int v = 0; v < numVertices; ++v) {
+            if (outOffset[v + 1] - outOffset[v] - 1 > best) best = outOffset[v + 1] - outOffset[v] - 1;
+            if (inOffset[v + 1] - inOffset[v] - 1 > best) best = inOffset[v + 1] - inOffset[v] - 1;
+        }
+        return best;
+    }
+    long long memoryBytes() const {
+        return ((long long)outOffset[numVertices] + inOffset[numVertices]) * 3 * sizeof(int) +
+               2LL * (numVertices + 1) * sizeof(int) + (long long)numVertices * sizeof(int);
+    }
+
+    void query(const int* startIndices, int numStarts, const int* endIndices, int numEnds,
+               PathResult& result, SearchWorkspace& workspace) {
+        int best = INF;
+        int bestHub = -1;
+        int bestStart = -1;
+        int bestEnd = -1;
+        for (int s = 0; s < numStarts; ++s) {
+            for (int t = 0; t < numEnds; ++t) {
+                int hub;
+                int d = distance(startIndices[s], endIndices[t], hub);
+                if (d < best) {
+                    best = d;
+                    bestHub = hub;
+                    bestStart = startIndices[s];
+                    bestEnd = endIndices[t];
+                }
+            }
+        }
+        result.settled = 0;
+        if (bestHub == -1) {
+            result.distance = INF;
+            result.previous = nullptr;
+            return;
+        }
+
+        // start -> hub, then hub -> end; the halves may share nodes when
+        // zero-weight edges exist, and extendRoute() cuts those loops
+        workspace.prepare(numVertices);
+        int hubNode = order[bestHub];
+        for (int v = bestStart; v != hubNode; ) {
+            workspace.extendRoute(v);
+            v = outParent[findEntry(outHub, outOffset[v], outOffset[v + 1], bestHub)];
+        }
+        workspace.extendRoute(hubNode);
+        IntStack& chain = workspace.chain;
+        chain.size = 0;
+        for (int v = bestEnd; v != hubNode; ) {
+            chain.push(v);
+            v = inParent[findEntry(inHub, inOffset[v], inOffset[v + 1], bestHub)];
+        }
+        while (!chain.isEmpty()) workspace.extendRoute(chain.pop());
+        int startIndex, endIndex;
+        workspace.finishRoute(startIndex, endIndex);
+        result.distance = best;
+        result.previous = workspace.path;
+        result.startIndex = startIndex;
+        result.endIndex = endIndex;
+    }
+};
+
+
+
+ManualGraph::~ManualGraph() {
+    for (int i = 0; adjLists != nullptr && i < numVertices; ++i) {
+        AdjListNode* current = adjLists[i];
+        while (current != nullptr) {
+            AdjListNode* temp = current;
+            current = current->next;
+            delete temp;
+        }
+        current = reverseAdjLists[i];
+        while (current != nullptr) {
+            AdjListNode* temp = current;
+            current = current->next;
+            delete temp;
+        }
+    }
+    delete[] adjLists;
+    delete[] reverseAdjLists;
+    delete[] packedEdges;
+    delete[] weightTable;
+    if (!borrowedArrays) {
+        delete[] blockStart;
+        delete[] undirectedStart;
+        delete[] outOnlyStart;
+        delete[] edgeTargets;
+        delete[] edgeWeights;
+        delete[] nodeX;
+        delete[] nodeY;
+        delete[] nodeType;
+        delete[] externalId;
+        delete[] internalId;
+    }
+    delete nodeMap;
+    delete idHash;
+    delete prefixIndex;
+    delete doorGroups;
+    delete fuzzyIndex;
+    delete roomNames;
+    delete[] roomOf;
+    delete names;
+    delete ch;
+    delete landmarks;
+    delete table;
+    delete hubLabels;
+    MappedFile::unmap(mappedBase, mappedBytes);
+}
+
+
+
+// Search engines selectable per query
+enum SearchEngine {
+    ENGINE_DIJKSTRA,
+    ENGINE_ASTAR,
+    ENGINE_BIDIRECTIONAL,
+    ENGINE_CH,
+    ENGINE_ALT,
+    ENGINE_TABLE,
+    ENGINE_HUB
+};
+
+const int DEFAULT_LANDMARKS = 8;
+// Largest graph the table engine precomputes (2 * V * V ints, 32 MB at 2048);
+// bigger graphs fall back to searching on demand.
+const int DEFAULT_TABLE_LIMIT = 2048;
+
+const char* engineName(SearchEngine engine) {
+    switch (engine) {
+        case ENGINE_ASTAR: return "astar";
+        case ENGINE_BIDIRECTIONAL: return "bidirectional";
+        case ENGINE_CH: return "ch";
+        case ENGINE_ALT: return "alt";
+        case ENGINE_TABLE: return "table";
+        case ENGINE_HUB: return "hub";
+        default: return "dijkstra";
+    }
+}
+
+bool parseEngine(const char* name, SearchEngine& engine) {
+    if (strcmp(name, "dijkstra") == 0) { engine = ENGINE_DIJKSTRA; return true; }
+    if (strcmp(name, "astar") == 0) { engine = ENGINE_ASTAR; return true; }
+    if (strcmp(name, "bidirectional") == 0) { engine = ENGINE_BIDIRECTIONAL; return true; }
+    if (strcmp(name, "ch") == 0) { engine = ENGINE_CH; return true; }
+    if (strcmp(name, "alt") == 0) { engine = ENGINE_ALT; return true; }
+    if (strcmp(name, "table") == 0) { engine = ENGINE_TABLE; return true; }
+    if (strcmp(name, "hub") == 0) { engine = ENGINE_HUB; return true; }
+    return false;
+}
+
+// tableLimit: largest graph the table engine precomputes (--table-limit)
+void findPath(ManualGraph* graph, SearchEngine engine, const int* startIndices, int numStarts,
+              const int* endIndices, int numEnds, PathResult& result, SearchWorkspace& workspace,
+              int tableLimit, QueueBackend backend = DIJKSTRA_QUEUE) {
+    switch (engine) {
+        case ENGINE_ASTAR:
+            aStarMulti(graph, startIndices, numStarts, endIndices, numEnds, result, workspace);
+            break;
+        case ENGINE_BIDIRECTIONAL:
+            bidirectionalDijkstra(graph, startIndices, numStarts, endIndices, numEnds, result, workspace);
+            break;
+        case ENGINE_CH:
+            if (graph->ch == nullptr) graph->ch = new ContractionHierarchy(graph);
+            graph->ch->query(startIndices, numStarts, endIndices, numEnds, result, workspace);
+            break;
+        case ENGINE_ALT:
+            if (graph->landmarks == nullptr) {
+                graph->landmarks = new LandmarkTable();
+                graph->landmarks->build(graph, DEFAULT_LANDMARKS);
+            }
+            aStarMulti(graph, startIndices, numStarts, endIndices, numEnds, result, workspace, graph->landmarks);
+            break;
+        case ENGINE_TABLE:
+            if (graph->table == nullptr && graph->numVertices <= tableLimit) {
+                graph->table = new DistanceTable(graph);
+            }
+            if (graph->table != nullptr) {
+                graph->table->query(startIndices, numStarts, endIndices, numEnds, result, workspace);
+            } else {
+                dijkstraMulti(graph, startIndices, numStarts, endIndices, numEnds, result, workspace, backend);
+            }
+            break;
+        case ENGINE_HUB:
+            if (graph->hubLabels == nullptr) {
+                if (graph->ch == nullptr) graph->ch = new ContractionHierarchy(graph);
+                graph->hubLabels = new HubLabels(graph);
+            }
+            graph->hubLabels->query(startIndices, numStarts, endIndices, numEnds, result, workspace);
+            break;
+        default:
+            dijkstraMulti(graph, startIndices, numStarts, endIndices, numEnds, result, workspace, backend);
+            break;
+    }
+}
+
+
+
+// Benchmarks (--bench <name>)
+
+// small deterministic generator so runs are comparable
+unsigned int benchRandom(unsigned int& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Synthetic campus: a side x side grid of corridors 100 px apart with random
+// integer weights, about 10% of segments missing, every segment both ways.
+// Pass freezeGraph = false to keep the linked adjacency lists.
+// shuffleNodes adds the nodes in random order, like a hand-drawn graph file.
+ManualGraph* buildGridGraph(int side, unsigned int seed, bool freezeGraph = true, bool shuffleNodes = false) {
+    ManualGraph* graph = new ManualGraph(side * side);
+    char name[32];
+    int* cells = new int[side * side];
+    for (int i = 0; i < side * side; ++i) cells[i] = i;
+    if (shuffleNodes) {
+        unsigned int shuffleState = seed ^ 0x5bd1e995u;
+        for (int i = side * side - 1; i > 0; --i) {
+            int j = benchRandom(shuffleState) % (i + 1);
+            int t = cells[i];
+            cells[i] = cells[j];
+            cells[j] = t;
+        }
+    }
+    for (int i = 0; i < side * side; ++i) {
+        int r = cells[i] / side;
+        int c = cells[i] % side;
+        snprintf(name, sizeof(name), "G%d_%d", r, c);
+        graph->addNode(name, c * 100, r * 100, NODE_HALLWAY);
+    }
+    delete[] cells;
+    unsigned int state = seed;
+    char other[32];
+    for (int r = 0; r < side; ++r) {
+        for (int c = 0; c < side; ++c) {
+            snprintf(name, sizeof(name), "G%d_%d", r, c);
+            for (int dir = 0; dir < 2; ++dir) {
+                int r2 = r + dir;
+                int c2 = c + 1 - dir;
+                if (r2 >= side || c2 >= side || benchRandom(state) % 10 == 0) continue;
+                int weight = 500 + (int)(benchRandom(state) % 1001);
+                snprintf(other, sizeof(other), "G%d_%d", r2, c2);
+                graph->addEdge(name, other, weight);
+                graph->addEdge(other, name, weight);
+            }
+        }
+    }
+    if (freezeGraph) graph->freeze();
+    return graph;
+}
+
+double millisSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// Runs the same random point-to-point queries with every queue backend and
+// checks that they agree on the distances.
+void benchQueuesOn(ManualGraph* graph, const char* label, int queries) {
+    int* sources = new int[queries];
+    int* targets = new int[queries];
+    unsigned int state = 12345;
+    for (int q = 0; q < queries; ++q) {
+        sources[q] = benchRandom(state) % graph->numVertices;
+        targets[q] = benchRandom(state) % graph->numVertices;
+    }
+    long long* reference = new long long[queries];
+    cout << label << " (" << graph->numVertices << " nodes, " << graph->numEdges << " edges, "
+         << queries << " queries)" << endl;
+    QueueBackend backends[3] = {QUEUE_HEAP, QUEUE_RADIX, QUEUE_DIAL};
+    SearchWorkspace workspace;
+    for (int b = 0; b < 3; ++b) {
+        bool agree = true;
+        auto start = chrono::steady_clock::now();
+        for (int q = 0; q < queries; ++q) {
+            PathResult result;
+            dijkstraMulti(graph, &sources[q], 1, &targets[q], 1, result, workspace, backends[b]);
+            if (b == 0) reference[q] = result.distance;
+            else if (reference[q] != result.distance) agree = false;
+        }
+        double elapsed = millisSince(start);
+        cout << "  " << queueName(backends[b]) << ": " << elapsed / queries << " ms/query";
+        if (effectiveQueue(backends[b], graph->maxEdgeWeight) != backends[b]) {
+            cout << " (as " << queueName(effectiveQueue(backends[b], graph->maxEdgeWeight)) << ")";
+        }
+        cout << (agree ? "" : "  (DISTANCES DIFFER)") << endl;
+    }
+    delete[] sources;
+    delete[] targets;
+    delete[] reference;
+}
+
+// Full searches over the linked lists and over the CSR arrays of the same
+// graph; both count relaxations so throughput can be compared directly.
+long long listSearch(ManualGraph* graph, int source, int* distances, MinPriorityQueue& pq) {
+    for (int i = 0; i < graph->numVertices; ++i) distances[i] = INF;
+    long long relaxations = 0;
+    distances[source] = 0;
+    pq.insert(source, 0);
+    while (!pq.isEmpty()) {
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+        for (AdjListNode* neighbor = graph->adjLists[u]; neighbor != nullptr; neighbor = neighbor->next) {
+            relaxations++;
+            int newDist = minNode.distance + neighbor->weight;
+            if (newDist < distances[neighbor->destIndex]) {
+                distances[neighbor->destIndex] = newDist;
+                pq.insert(neighbor->destIndex, newDist);
+            }
+        }
+    }
+    return relaxations;
+}
+
+long long csrSearch(ManualGraph* graph, int source, int* distances, MinPriorityQueue& pq) {
+    for (int i = 0; i < graph->numVertices; ++i) distances[i] = INF;
+    long long relaxations = 0;
+    const EdgeArrays& edges = graph->outEdges;
+    distances[source] = 0;
+    pq.insert(source, 0);
+    while (!pq.isEmpty()) {
+        HeapNode minNode = pq.extractMin();
+        int u = minNode.nodeIndex;
+        for (int e = edges.begin[u]; e < edges.end[u]; ++e) {
+            relaxations++;
+            int newDist = minNode.distance + edges.weight(e);
+            if (newDist < distances[edges.target(e)]) {
+                distances[edges.target(e)] = newDist;
+                pq.insert(edges.target(e), newDist);
+            }
+        }
+    }
+    return relaxations;
+}
+
+void benchLayout() {
+    int sides[3] = {100, 300, 700};
+    for (int i = 0; i < 3; ++i) {
+        // edges are added through addEdge() exactly like the JSON loader does
+        ManualGraph* grid = buildGridGraph(sides[i], 2024, false);
+        int V = grid->numVertices;
+        int* distances = new int[V];
+        MinPriorityQueue pq(V);
+        int sources = sides[i] >= 700 ? 5 : 20;
+        unsigned int state = 777;
+        int* picks = new int[sources];
+        for (int q = 0; q < sources; ++q) picks[q] = benchRandom(state) % V;
+
+        long long listRelax = 0;
+        auto start = chrono::steady_clock::now();
+        for (int q = 0; q < sources; ++q) listRelax += listSearch(grid, picks[q], distances, pq);
+        double listMillis = millisSince(start);
+        long long listChecksum = 0;
+        for (int v = 0; v < V; ++v) listChecksum += distances[v] == INF ? 0 : distances[v];
+
+        grid->freeze();
+        long long csrRelax = 0;
+        start = chrono::steady_clock::now();
+        for (int q = 0; q < sources; ++q) csrRelax += csrSearch(grid, picks[q], distances, pq);
+        double csrMillis = millisSince(start);
+        long long csrChecksum = 0;
+        for (int v = 0; v < V; ++v) csrChecksum += distances[v] == INF ? 0 : distances[v];
+
+        cout << "synthetic grid " << sides[i] << "x" << sides[i] << " (" << V << " nodes, "
+             << grid->numEdges << " edges, " << sources << " full searches)" << endl;
+        cout << "  linked lists: " << listMillis / sources << " ms/search, "
+             << listRelax / (listMillis * 1000.0) << " M relaxations/s" << endl;
+        cout << "  CSR arrays:   " << csrMillis / sources << " ms/search, "
+             << csrRelax / (csrMillis * 1000.0) << " M relaxations/s"
+             << (listChecksum == csrChecksum ? "" : "  (DISTANCES DIFFER)") << endl;
+        delete[] distances;
+        delete[] picks;
+        delete grid;
+    }
+}
+
+// Node-name tables: inserts, hits and misses on campus-style names, against
+// the chained table sized numVertices * 2 the way ManualGraph used it.
+template <class Table>
+void benchTableOps(Table& table, const char* keys, const char* misses, int n, int keyWidth,
+                   double& insertMillis, double& hitMillis, double& missMillis, long long& checksum) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) table.insert(keys + (long long)i * keyWidth, i);
+    insertMillis = millisSince(start);
+    checksum = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0, k = 0; i < n; ++i, k = (k + 7919) % n) checksum += table.get(keys + (long long)k * keyWidth);
+    hitMillis = millisSince(start);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i) checksum += table.get(misses + (long long)i * keyWidth);
+    missMillis = millisSince(start);
+}
+
+void benchHash() {
+    const int keyWidth = 16;
+    int sizes[4] = {1000, 10000, 100000, 1000000};
+    for (int s = 0; s < 4; ++s) {
+        int n = sizes[s];
+        char* keys = new char[(long long)n * keyWidth];
+        char* misses = new char[(long long)n * keyWidth];
+        for (int i = 0; i < n; ++i) {
+            snprintf(keys + (long long)i * keyWidth, keyWidth, "CP%d%c", i / 2, i % 2 == 0 ? 'a' : 'b');
+            snprintf(misses + (long long)i * keyWidth, keyWidth, "P%dx", i);
+        }
+        double insertMillis, hitMillis, missMillis;
+        long long checksum;
+        cout << n << " keys" << endl;
+        {
+            ChainedHashTable chained(n * 2);
+            benchTableOps(chained, keys, misses, n, keyWidth, insertMillis, hitMillis, missMillis, checksum);
+            cout << "  chained:    insert " << insertMillis * 1e6 / n << " ns, hit " << hitMillis * 1e6 / n
+                 << " ns, miss " << missMillis * 1e6 / n << " ns, "
+                 << (long long)n * sizeof(ChainedHashNode) + (long long)n * 2 * sizeof(ChainedHashNode*)
+                 << " bytes" << endl;
+        }
+        long long expected = checksum;
+        {
+            HashTable robinHood(16); // starts small, grows on its own
+            benchTableOps(robinHood, keys, misses, n, keyWidth, insertMillis, hitMillis, missMillis, checksum);
+            cout << "  robin hood: insert " << insertMillis * 1e6 / n << " ns, hit " << hitMillis * 1e6 / n
+                 << " ns, miss " << missMillis * 1e6 / n << " ns, " << robinHood.memoryBytes() << " bytes"
+                 << (checksum == expected ? "" : "  (RESULTS DIFFER)") << endl;
+        }
+        {
+            NamePool keyPool(n, 0);
+            for (int i = 0; i < n; ++i) {
+                const char* key = keys + (long long)i * keyWidth;
+                keyPool.intern(key, strlen(key));
+            }
+            NodeIdPerfectHash perfect;
+            bool built = perfect.build(&keyPool, n);
+            checksum = 0;
+            auto start = chrono::steady_clock::now();
+            for (int i = 0, k = 0; i < n; ++i, k = (k + 7919) % n) checksum += perfect.get(keys + (long long)k * keyWidth);
+            hitMillis = millisSince(start);
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < n; ++i) checksum += perfect.get(misses + (long long)i * keyWidth);
+            missMillis = millisSince(start);
+            cout << "  perfect:    build " << perfect.buildMillis * 1e6 / n << " ns, hit " << hitMillis * 1e6 / n
+                 << " ns, miss " << missMillis * 1e6 / n << " ns, " << perfect.memoryBytes() << " bytes"
+                 << (built && checksum == expected ? "" : "  (RESULTS DIFFER)") << endl;
+        }
+        delete[] keys;
+        delete[] misses;
+    }
+}
+
+// Door lookups: bases are random node names with the last character cut off,
+// resolved by the linear scan and by the prefix index.
+void benchDoorsOn(ManualGraph* graph, const char* label, int queries) {
+    int n = graph->names->size();
+    char** bases = new char*[queries];
+    unsigned int state = 4242;
+    for (int q = 0; q < queries; ++q) {
+        int id = benchRandom(state) % n;
+        int length = graph->names->length(id);
+        bases[q] = new char[length + 1];
+        memcpy(bases[q], graph->names->c_str(id), length);
+        bases[q][length > 1 ? length - 1 : length] = '\0';
+    }
+    long long scanFound = 0;
+    auto start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        StringList list;
+        scanNodeVariations(graph, string_view(bases[q]), &list);
+        scanFound += list.count;
+    }
+    double scanMillis = millisSince(start);
+    long long indexFound = 0;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        StringList list;
+        indexNodeVariations(graph, string_view(bases[q]), &list);
+        indexFound += list.count;
+    }
+    double indexMillis = millisSince(start);
+    cout << label << " (" << n << " names): scan " << scanMillis * 1000.0 / queries << " us, prefix index "
+         << indexMillis * 1000.0 / queries << " us per lookup, " << graph->prefixIndex->memoryBytes() << " bytes"
+         << (scanFound == indexFound ? "" : "  (RESULTS DIFFER)") << endl;
+    for (int q = 0; q < queries; ++q) delete[] bases[q];
+    delete[] bases;
+}
+
+void benchDoors(ManualGraph* campus) {
+    benchDoorsOn(campus, "campus graph", 2000);
+    int sides[3] = {100, 300, 1000};
+    for (int i = 0; i < 3; ++i) {
+        ManualGraph* grid = buildGridGraph(sides[i], 2024);
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic grid %dx%d", sides[i], sides[i]);
+        benchDoorsOn(grid, label, sides[i] >= 1000 ? 20 : 200);
+        delete grid;
+    }
+}
+
+// Fuzzy lookups: node names with one typo (swapped neighbours, a changed
+// character, a dropped character) plus random case and separators, counting
+// how often the intended name is among the top 5 suggestions. Also checks
+// that every name typed in lower case is resolved back to itself by the
+// prompt (h14 -> H14, even with a room H14 next to the node).
+void benchFuzzyOn(ManualGraph* graph, const char* label, int queries) {
+    FuzzyNameIndex* index = graph->fuzzy();
+    int n = graph->names->size();
+    unsigned int state = 99;
+    char typed[128];
+    int hits = 0;
+    int resolved = 0;
+    double totalMicros = 0.0;
+    FuzzyMatch matches[5];
+    for (int q = 0; q < queries; ++q) {
+        int id = benchRandom(state) % n;
+        string_view name = graph->names->view(id);
+        int length = (int)name.size() < 60 ? (int)name.size() : 60;
+        char word[64];
+        memcpy(word, name.data(), length);
+        int at = length > 1 ? benchRandom(state) % (length - 1) : 0;
+        switch (benchRandom(state) % 3) {
+        case 0: { char c = word[at]; word[at] = word[at + 1]; word[at + 1] = c; break; }
+        case 1: word[at] = 'x'; break;
+        default: memmove(word + at, word + at + 1, length - at - 1); length--; break;
+        }
+        int t = 0;
+        for (int i = 0; i < length; ++i) {
+            char c = word[i];
+            if (benchRandom(state) % 2 == 0 && c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+            typed[t++] = c;
+            if (i + 1 < length && benchRandom(state) % 8 == 0) typed[t++] = '-';
+        }
+        typed[t] = '\0';
+        auto start = chrono::steady_clock::now();
+        int found = index->suggest(typed, 5, matches);
+        totalMicros += millisSince(start) * 1000.0;
+        for (int i = 0; i < found; ++i) {
+            if (index->name(matches[i].entry) == name) hits++;
+        }
+
+        string lower(name);
+        for (char& c : lower) {
+            if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        }
+        const int* doors;
+        int* buffer;
+        if (resolveTypedName(graph, lower, doors, buffer) > 0 && lower == name) resolved++;
+        delete[] buffer;
+    }
+    cout << label << " (" << index->entryCount() << " entries): build " << index->buildMillis << " ms, "
+         << totalMicros / queries << " us per lookup, intended name in top 5: " << hits * 100.0 / queries << "%, "
+         << "lower case resolved: " << resolved * 100.0 / queries << "%, " << index->memoryBytes() << " bytes" << endl;
+}
+
+void benchFuzzy(ManualGraph* campus) {
+    benchFuzzyOn(campus, "campus graph", 2000);
+    int sides[2] = {300, 1000};
+    for (int i = 0; i < 2; ++i) {
+        ManualGraph* grid = buildGridGraph(sides[i], 2024);
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic grid %dx%d", sides[i], sides[i]);
+        benchFuzzyOn(grid, label, 2000);
+        delete grid;
+    }
+}
+
+// Node orders on a grid whose nodes were added in random order: reorder
+// time, how close edge endpoints are in memory (the share of edges whose
+// target lies within 16 ints, one cache line, of the source) and dijkstra
+// query time for the same random pairs.
+void benchOrder() {
+    int sides[2] = {300, 700};
+    NodeOrder orders[4] = {ORDER_INPUT, ORDER_HILBERT, ORDER_BFS, ORDER_RCM};
+    for (int s = 0; s < 2; ++s) {
+        int queries = sides[s] >= 700 ? 10 : 40;
+        cout << "shuffled grid " << sides[s] << "x" << sides[s] << " (" << queries << " queries)" << endl;
+        long long reference = -1;
+        for (int o = 0; o < 4; ++o) {
+            ManualGraph* grid = buildGridGraph(sides[s], 2024, false, true);
+            auto start = chrono::steady_clock::now();
+            grid->freeze(orders[o]);
+            double freezeMillis = millisSince(start);
+            int V = grid->numVertices;
+            long long near = 0, gap = 0;
+            for (int u = 0; u < V; ++u) {
+                for (int e = grid->outEdges.begin[u]; e < grid->outEdges.end[u]; ++e) {
+                    int d = grid->outEdges.target(e) - u;
+                    if (d < 0) d = -d;
+                    if (d < 16) near++;
+                    gap += d;
+                }
+            }
+            // the same input positions in every order
+            unsigned int state = 31337;
+            long long checksum = 0;
+            SearchWorkspace workspace;
+            start = chrono::steady_clock::now();
+            for (int q = 0; q < queries; ++q) {
+                int source = grid->internalId[benchRandom(state) % V];
+                int target = grid->internalId[benchRandom(state) % V];
+                PathResult result;
+                dijkstraMulti(grid, &source, 1, &target, 1, result, workspace);
+                checksum += result.distance;
+            }
+            double queryMillis = millisSince(start);
+            if (reference == -1) reference = checksum;
+            cout << "  " << orderName(orders[o]) << ": freeze " << freezeMillis << " ms, edges within a cache line "
+                 << near * 100.0 / grid->numEdges << "%, mean index gap " << (double)gap / grid->numEdges
+                 << ", " << queryMillis / queries << " ms/query"
+                 << (checksum == reference ? "" : "  (DISTANCES DIFFER)") << endl;
+            delete grid;
+        }
+    }
+}
+
+// Plain int target/weight entries against packEdges() words on the same
+// graph: edge bytes per directed edge and dijkstra query time.
+void benchEdgesOn(ManualGraph* graph, const char* label, int queries) {
+    int V = graph->numVertices;
+    int* sources = new int[queries];
+    int* targets = new int[queries];
+    unsigned int state = 4242;
+    for (int q = 0; q < queries; ++q) {
+        sources[q] = benchRandom(state) % V;
+        targets[q] = benchRandom(state) % V;
+    }
+    SearchWorkspace workspace;
+    workspace.prepare(V);
+    cout << label << " (" << V << " nodes, " << graph->numEdges << " edges, " << queries << " queries)" << endl;
+    long long reference = -1;
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1 && !graph->packEdges()) {
+            cout << "  packed: weights do not fit next to the targets in 32 bits" << endl;
+            break;
+        }
+        long long checksum = 0;
+        auto start = chrono::steady_clock::now();
+        for (int q = 0; q < queries; ++q) {
+            PathResult result;
+            dijkstraMulti(graph, &sources[q], 1, &targets[q], 1, result, workspace);
+            checksum += result.distance;
+        }
+        double millis = millisSince(start);
+        if (reference == -1) reference = checksum;
+        cout << "  " << (pass == 0 ? "plain: " : "packed:") << " " << (double)graph->edgeBytes() / graph->numEdges
+             << " bytes/edge, " << millis / queries << " ms/query";
+        if (pass == 1) cout << ", " << graph->numWeightClasses << " weight classes";
+        cout << (checksum == reference ? "" : "  (DISTANCES DIFFER)") << endl;
+    }
+    delete[] sources;
+    delete[] targets;
+}
+
+void benchEdges(ManualGraph* campus) {
+    benchEdgesOn(campus, "campus graph", 2000);
+    int sides[2] = {300, 700};
+    for (int i = 0; i < 2; ++i) {
+        ManualGraph* grid = buildGridGraph(sides[i], 2024);
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic grid %dx%d", sides[i], sides[i]);
+        benchEdgesOn(grid, label, sides[i] >= 700 ? 20 : 100);
+        delete grid;
+    }
+}
+
+void benchQueues(ManualGraph* campus) {
+    benchQueuesOn(campus, "campus graph", 2000);
+    int sides[3] = {100, 300, 700};
+    for (int i = 0; i < 3; ++i) {
+        ManualGraph* grid = buildGridGraph(sides[i], 2024);
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic grid %dx%d", sides[i], sides[i]);
+        benchQueuesOn(grid, label, sides[i] >= 700 ? 10 : 50);
+        delete grid;
+    }
+}
+
+
+
+// How main() reads the JSON graph
+enum GraphLoader {
+    LOADER_DOM,   // json::parse into a full document tree, then walk it
+    LOADER_SAX,   // json::sax_parse straight into staging arrays
+    LOADER_SCHEMA // hand-written parser for the graph schema, SAX as fallback
 };
 
-class PathStack {
+const char* loaderName(GraphLoader loader) {
+    switch (loader) {
+        case LOADER_DOM: return "dom";
+        case LOADER_SAX: return "sax";
+        default: return "schema";
+    }
+}
+
+bool parseLoader(const char* name, GraphLoader& loader) {
+    if (strcmp(name, "dom") == 0) { loader = LOADER_DOM; return true; }
+    if (strcmp(name, "sax") == 0) { loader = LOADER_SAX; return true; }
+    if (strcmp(name, "schema") == 0) { loader = LOADER_SCHEMA; return true; }
+    return false;
+}
+
+// Nodes and edges as the streaming loaders meet them. Every name is interned
+// once in a staging table; nodes and edges are staged as ids and numbers.
+// The graph is built at the end, because its node count must be known up
+// front and edges may name nodes listed later. Memory follows the node and
+// edge counts, not the size of the text.
+class GraphStaging {
 private:
-    StackNode* top;
+    HashTable names;    // node and endpoint names -> staging id
+    NamePool roomNames; // explicit room fields, in first-seen order
+    HashTable roomIds;
+    IntStack nodeName, nodeX, nodeY, nodeType, nodeRoom;
+    IntStack edgeSource, edgeTarget, edgeWeight;
+    long long nodeNameChars;
+
 public:
-    PathStack() : top(nullptr) {}
-    ~PathStack() {
-        while (!isEmpty()) {
-            pop();
+    GraphStaging() : names(1024), roomNames(16, 0), roomIds(16), nodeNameChars(0) {}
+
+    int nameId(const char* name) {
+        int staged = names.get(name);
+        if (staged == -1) {
+            staged = names.size();
+            names.insert(name, staged);
         }
+        return staged;
     }
-    bool isEmpty() {
-        return top == nullptr;
+    int roomId(const char* room) {
+        int staged = roomIds.get(room);
+        if (staged == -1) {
+            staged = roomNames.intern(room, strlen(room));
+            roomIds.insert(room, staged);
+        }
+        return staged;
     }
-    void push(int nodeIndex) {
-        StackNode* newNode = new StackNode();
-        newNode->nodeIndex = nodeIndex;
-        newNode->next = top;
-        top = newNode;
+    // room: staged room id or -1
+    void addNode(int name, int x, int y, NodeType type, int room) {
+        nodeName.push(name);
+        nodeX.push(x);
+        nodeY.push(y);
+        nodeType.push(type);
+        nodeRoom.push(room);
+        nodeNameChars += names.keyNames()->length(name) + 1;
     }
-    int pop() {
-        if (isEmpty()) {
-            return -1;
+    void addEdge(int source, int target, int weight) {
+        edgeSource.push(source);
+        edgeTarget.push(target);
+        edgeWeight.push(weight);
+    }
+
+    // Builds the graph from the staged nodes and edges (not yet frozen).
+    ManualGraph* build() {
+        const NamePool* pool = names.keyNames();
+        ManualGraph* graph = new ManualGraph(nodeName.size, (int)nodeNameChars);
+        for (int i = 0; i < nodeName.size; ++i) {
+            int r = nodeRoom.items[i];
+            graph->addNode(pool->c_str(nodeName.items[i]), nodeX.items[i], nodeY.items[i], (NodeType)nodeType.items[i],
+                           r != -1 ? roomNames.c_str(r) : nullptr);
         }
-        StackNode* temp = top;
-        int nodeIndex = temp->nodeIndex;
-        top = top->next;
-        delete temp;
-        return nodeIndex;
+        for (int e = 0; e < edgeSource.size; ++e) {
+            graph->addEdge(pool->c_str(edgeSource.items[e]), pool->c_str(edgeTarget.items[e]), edgeWeight.items[e]);
+        }
+        return graph;
     }
 };
 
+// SAX handler for the graph JSON: node and edge fields are picked up as the
+// parser streams past them and go into a GraphStaging, no document tree.
+class GraphSaxBuilder : public json::json_sax_t {
+private:
+    enum Section { SECTION_NONE, SECTION_NODES, SECTION_EDGES };
+    enum Field { FIELD_OTHER, FIELD_ID, FIELD_X, FIELD_Y, FIELD_TYPE, FIELD_ROOM, FIELD_SOURCE, FIELD_TARGET, FIELD_WEIGHT };
+    int depth;          // open objects and arrays; items of "nodes"/"edges" sit at depth 3
+    Section pendingSection;
+    Section section;
+    Field field;
+    // fields of the current item
+    int id, source, target, room;
+    long long x, y, weight;
+    NodeType type;
+    bool hasWeight;
 
-// graph implementation
-struct AdjListNode {
-    int destIndex; // index of the destination node
-    int weight; // weight of the edge
-    AdjListNode* next; // pointer to the next node
-    AdjListNode() : destIndex(-1), weight(0), next(nullptr) {}
-};
+    bool atField() const {
+        return section != SECTION_NONE && depth == 3;
+    }
+    bool number(long long value) {
+        if (!atField()) return true;
+        if (field == FIELD_X) x = value;
+        else if (field == FIELD_Y) y = value;
+        else if (field == FIELD_WEIGHT) {
+            weight = value;
+            hasWeight = true;
+        }
+        return true;
+    }
 
-class ManualGraph {
 public:
-    int numVertices;
-    AdjListNode** adjLists;
-    HashTable* nodeMap;
-    char** indexToName;
-    int currentNodeIndex;
+    GraphStaging staging;
+    string_t error; // 'string' is the SAX callback below
 
-    ManualGraph(int vertices) : numVertices(vertices), currentNodeIndex(0) {
-        adjLists = new AdjListNode*[numVertices];
-        nodeMap = new HashTable(numVertices * 2);
-        indexToName = new char*[numVertices];
-        for (int i = 0; i < numVertices; ++i) {
-            adjLists[i] = nullptr;
-            indexToName[i] = new char[50];
-            indexToName[i][0] = '\0';
+    GraphSaxBuilder() : depth(0), pendingSection(SECTION_NONE), section(SECTION_NONE), field(FIELD_OTHER) {}
+
+    bool null() override {
+        return true;
+    }
+    bool boolean(bool) override {
+        return true;
+    }
+    bool number_integer(number_integer_t value) override {
+        return number(value);
+    }
+    bool number_unsigned(number_unsigned_t value) override {
+        return number((long long)value);
+    }
+    bool number_float(number_float_t value, const string_t&) override {
+        return number((long long)value);
+    }
+    bool string(string_t& value) override {
+        if (!atField()) return true;
+        switch (field) {
+            case FIELD_ID: id = staging.nameId(value.c_str()); break;
+            case FIELD_SOURCE: source = staging.nameId(value.c_str()); break;
+            case FIELD_TARGET: target = staging.nameId(value.c_str()); break;
+            case FIELD_TYPE: type = parseNodeType(value.c_str()); break;
+            case FIELD_ROOM: room = staging.roomId(value.c_str()); break;
+            default: break;
         }
+        return true;
     }
-    ~ManualGraph() {
-        for (int i = 0; i < numVertices; ++i) {
-            AdjListNode* current = adjLists[i];
-            while (current != nullptr) {
-                AdjListNode* temp = current;
-                current = current->next;
-                delete temp;
-            }
-            delete[] indexToName[i];
+    bool binary(binary_t&) override {
+        return true;
+    }
+    bool start_object(std::size_t) override {
+        depth++;
+        if (atField()) {
+            id = source = target = room = -1;
+            x = y = weight = 0;
+            type = NODE_OTHER;
+            hasWeight = false;
+            field = FIELD_OTHER;
         }
-        delete[] adjLists;
-        delete[] indexToName;
-        delete nodeMap;
+        return true;
     }
-    void addNode(const char* name) {
-        if (currentNodeIndex < numVertices && nodeMap->get(name) == -1) {
-            nodeMap->insert(name, currentNodeIndex);
-            strcpy(indexToName[currentNodeIndex], name);
-            currentNodeIndex++;
+    bool end_object() override {
+        if (atField()) {
+            if (section == SECTION_NODES && id != -1) {
+                staging.addNode(id, (int)x, (int)y, type, room);
+            } else if (section == SECTION_EDGES && source != -1 && target != -1 && hasWeight) {
+                staging.addEdge(source, target, (int)weight);
+            }
         }
+        depth--;
+        return true;
     }
-    void addEdge(const char* srcName, const char* destName, int weight) {
-        int srcIndex = nodeMap->get(srcName);
-        int destIndex = nodeMap->get(destName);
-        if (srcIndex == -1 || destIndex == -1) {
-            return;
+    bool start_array(std::size_t) override {
+        if (depth == 1) section = pendingSection;
+        depth++;
+        return true;
+    }
+    bool end_array() override {
+        depth--;
+        if (depth == 1) section = SECTION_NONE;
+        return true;
+    }
+    bool key(string_t& name) override {
+        if (depth == 1) {
+            pendingSection = name == "nodes" ? SECTION_NODES : name == "edges" ? SECTION_EDGES : SECTION_NONE;
+        } else if (atField()) {
+            if (name == "id") field = FIELD_ID;
+            else if (name == "x") field = FIELD_X;
+            else if (name == "y") field = FIELD_Y;
+            else if (name == "type") field = FIELD_TYPE;
+            else if (name == "room") field = FIELD_ROOM;
+            else if (name == "source") field = FIELD_SOURCE;
+            else if (name == "target") field = FIELD_TARGET;
+            else if (name == "weight") field = FIELD_WEIGHT;
+            else field = FIELD_OTHER;
         }
-        AdjListNode* newNode = new AdjListNode();
-        newNode->destIndex = destIndex;
-        newNode->weight = weight;
-        newNode->next = adjLists[srcIndex];
-        adjLists[srcIndex] = newNode;
+        return true;
+    }
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& e) override {
+        error = e.what();
+        return false;
     }
 };
 
+// Parser for exactly the graph schema: a top-level object whose "nodes" array
+// holds {id, type, x, y, room} objects and whose "edges" array holds
+// {source, target, weight} objects; other keys and values (metadata) are
+// skipped. It reads the text in place: strings are scanned for the closing
+// quote 16 bytes at a time with SSE2, integers are parsed by hand without
+// locale or strtol. Input outside this subset (escaped names, fractional or
+// non-numeric coordinates, malformed JSON) makes parse() return false, and
+// the caller falls back to the nlohmann SAX loader.
+class SchemaGraphParser {
+private:
+    const char* p;
+    const char* end;
+    GraphStaging& staging;
+    string scratch; // NUL-terminated copy of the current name, reused
 
-
-// list that stires doors variation
-struct StringNode {
-    char name[50];
-    StringNode* next;
-};
-
-class StringList {
-public:
-    StringNode* head;
-    int count;
-    StringList() : head(nullptr), count(0) {}
-    ~StringList() {
-        StringNode* current = head;
-        while (current != nullptr) {
-            StringNode* temp = current;
-            current = current->next;
-            delete temp;
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    }
+    bool consume(char c) {
+        skipSpace();
+        if (p < end && *p == c) {
+            ++p;
+            return true;
         }
+        return false;
     }
-    void push(const char* name) {
-        StringNode* newNode = new StringNode();
-        strcpy(newNode->name, name);
-        newNode->next = head;
-        head = newNode;
-        count++;
+    // After an opening quote: the string up to the closing quote. Fails on
+    // an escape, which the fast path does not decode.
+    bool scanString(const char*& begin, int& length) {
+        begin = p;
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+            int hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+            if (hits != 0) {
+                p += __builtin_ctz(hits);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        while (p < end && *p != '"' && *p != '\\') ++p;
+        if (p >= end || *p == '\\') return false;
+        length = (int)(p - begin);
+        ++p;
+        return true;
     }
-};
-
-StringList* findNodeVariations(ManualGraph* graph, const char* name) {
-    StringList* list = new StringList();
-    int nameLen = strlen(name);
-    if (graph->nodeMap->get(name) != -1) {
-        list->push(name);
-        return list;
+    bool readString(const char*& begin, int& length) {
+        return consume('"') && scanString(begin, length);
+    }
+    // the current string as a C string, for the staging tables
+    bool readName(const char*& name) {
+        const char* begin;
+        int length;
+        if (!readString(begin, length)) return false;
+        scratch.assign(begin, length);
+        name = scratch.c_str();
+        return true;
+    }
+    bool readInt(long long& value) {
+        skipSpace();
+        bool negative = p < end && *p == '-';
+        if (negative) ++p;
+        const char* first = p;
+        long long v = 0;
+        while (p < end && *p >= '0' && *p <= '9' && p - first < 18) v = v * 10 + (*p++ - '0');
+        if (p == first || (p < end && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'e' || *p == 'E'))) return false;
+        if (*first == '0' && p - first > 1) return false; // leading zero
+        value = negative ? -v : v;
+        return true;
     }
-    for (int i = 0; i < graph->numVertices; ++i) {
-        const char* nodeName = graph->indexToName[i];
-        if (strncmp(nodeName, name, nameLen) == 0) {
-            int nodeNameLen = strlen(nodeName);
-            if (nodeNameLen > nameLen && nodeNameLen <= nameLen + 2) { 
-                list->push(nodeName);
+    static bool keyIs(const char* key, int length, const char* expected) {
+        return (int)strlen(expected) == length && memcmp(key, expected, length) == 0;
+    }
+    // Any JSON value, for the parts of the document the graph does not use.
+    bool skipValue(int nesting) {
+        skipSpace();
+        if (p >= end || nesting > 64) return false;
+        char c = *p;
+        if (c == '"') {
+            for (++p; p < end && *p != '"'; ++p) {
+                if ((unsigned char)*p < 0x20) return false; // raw control characters are not JSON
+                if (*p == '\\') ++p;
             }
+            if (p >= end) return false;
+            ++p;
+            return true;
+        }
+        if (c == '{' || c == '[') {
+            char close = c == '{' ? '}' : ']';
+            ++p;
+            if (consume(close)) return true;
+            do {
+                if (c == '{') {
+                    const char* key;
+                    int length;
+                    if (!readString(key, length) || !consume(':')) return false;
+                }
+                if (!skipValue(nesting + 1)) return false;
+            } while (consume(','));
+            return consume(close);
         }
+        if (c == 't') return skipWord("true");
+        if (c == 'f') return skipWord("false");
+        if (c == 'n') return skipWord("null");
+        return skipNumber();
+    }
+    bool skipWord(const char* word) {
+        int length = (int)strlen(word);
+        if (end - p < length || memcmp(p, word, length) != 0) return false;
+        p += length;
+        return true;
+    }
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool skipNumber() {
+        if (p < end && *p == '-') ++p;
+        if (p >= end || !isDigit(*p)) return false;
+        if (*p++ != '0') {
+            while (p < end && isDigit(*p)) ++p;
+        }
+        if (p < end && *p == '.') {
+            ++p;
+            if (p >= end || !isDigit(*p)) return false;
+            while (p < end && isDigit(*p)) ++p;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            if (p < end && (*p == '+' || *p == '-')) ++p;
+            if (p >= end || !isDigit(*p)) return false;
+            while (p < end && isDigit(*p)) ++p;
+        }
+        return true;
+    }
+    // Runs 'item' over every object of an array.
+    template <class Item>
+    bool readArray(Item item) {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        do {
+            if (!consume('{')) return false;
+            if (!item()) return false;
+        } while (consume(','));
+        return consume(']');
+    }
+    // Fields of one object up to and including its closing brace.
+    template <class Field>
+    bool readFields(Field field) {
+        if (consume('}')) return true;
+        do {
+            const char* key;
+            int length;
+            if (!readString(key, length) || !consume(':')) return false;
+            if (!field(key, length)) return false;
+        } while (consume(','));
+        return consume('}');
+    }
+    bool readNode() {
+        int id = -1, room = -1;
+        long long x = 0, y = 0;
+        NodeType type = NODE_OTHER;
+        bool ok = readFields([&](const char* key, int length) {
+            const char* name;
+            if (keyIs(key, length, "id")) {
+                if (!readName(name)) return false;
+                id = staging.nameId(name);
+            } else if (keyIs(key, length, "type")) {
+                if (!readName(name)) return false;
+                type = parseNodeType(name);
+            } else if (keyIs(key, length, "room")) {
+                if (!readName(name)) return false;
+                room = staging.roomId(name);
+            } else if (keyIs(key, length, "x")) {
+                return readInt(x);
+            } else if (keyIs(key, length, "y")) {
+                return readInt(y);
+            } else {
+                return skipValue(0);
+            }
+            return true;
+        });
+        if (ok && id != -1) staging.addNode(id, (int)x, (int)y, type, room);
+        return ok;
+    }
+    bool readEdge() {
+        int source = -1, target = -1;
+        long long weight = 0;
+        bool hasWeight = false;
+        bool ok = readFields([&](const char* key, int length) {
+            const char* name;
+            if (keyIs(key, length, "source")) {
+                if (!readName(name)) return false;
+                source = staging.nameId(name);
+            } else if (keyIs(key, length, "target")) {
+                if (!readName(name)) return false;
+                target = staging.nameId(name);
+            } else if (keyIs(key, length, "weight")) {
+                hasWeight = true;
+                return readInt(weight);
+            } else {
+                return skipValue(0);
+            }
+            return true;
+        });
+        if (ok && source != -1 && target != -1 && hasWeight) staging.addEdge(source, target, (int)weight);
+        return ok;
     }
-    return list;
-}
-
-
-
-// Dijkstra's Algorithm 
-
-const int INF = 2147483647;
 
-// This struct holds the result of a single Dijkstra run
-struct PathResult {
-    int distance;
-    int* previous; // pointer to the 'previous' array
-    int startIndex;
-    int endIndex;
+public:
+    SchemaGraphParser(const char* text, long long length, GraphStaging& into) : p(text), end(text + length), staging(into) {}
 
-    PathResult() : distance(INF), previous(nullptr), startIndex(-1), endIndex(-1) {}
+    bool parse() {
+        if (!consume('{')) return false;
+        bool ok = readFields([&](const char* key, int length) {
+            if (keyIs(key, length, "nodes")) return readArray([&]() { return readNode(); });
+            if (keyIs(key, length, "edges")) return readArray([&]() { return readEdge(); });
+            return skipValue(0);
+        });
+        skipSpace();
+        return ok && p == end;
+    }
 };
 
-void dijkstra(ManualGraph* graph, int startIndex, int endIndex, PathResult& result) {
-    int V = graph->numVertices;
+// Builds the (unfrozen) graph from a parsed document tree.
+ManualGraph* buildGraphFromDom(json& data) {
+    int numNodes = data["nodes"].size();
+    int nameChars = 0;
+    for (const auto& node : data["nodes"]) nameChars += (int)node["id"].get_ref<const string&>().size() + 1;
+    ManualGraph* graph = new ManualGraph(numNodes, nameChars);
+    for (const auto& node : data["nodes"]) {
+        string id = node["id"].get<string>();
+        string type = node.value("type", "");
+        auto room = node.find("room"); // optional explicit door group
+        graph->addNode(id.c_str(), node.value("x", 0), node.value("y", 0), parseNodeType(type.c_str()),
+                       room != node.end() && room->is_string() ? room->get_ref<const string&>().c_str() : nullptr);
+    }
+    for (const auto& edge : data["edges"]) {
+        string source = edge["source"].get<string>();
+        string target = edge["target"].get<string>();
+        int weight = edge["weight"].get<int>();
+        graph->addEdge(source.c_str(), target.c_str(), weight);
+    }
+    return graph;
+}
 
-    int* distances = new int[V];
-    int* previous = new int[V]; // This will be stored in 'result'
-    
-    for (int i = 0; i < V; ++i) {
-        distances[i] = INF;
-        previous[i] = -1;
+// The graph comes either as plain JSON or as the graph builder's
+// graph_data.js, which wraps the same object as `const GRAPH_DATA = {...};`.
+// Finds the JSON object inside the text without copying it: [begin, end)
+// skips a JS declaration before the '=' and a trailing ';'. Returns false
+// when the text is neither form.
+bool findJsonDocument(const char* text, long long length, const char*& begin, const char*& end, bool& wrapped) {
+    const char* p = text;
+    const char* stop = text + length;
+    if (length >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3; // UTF-8 byte order mark
+    while (p < stop && isspace((unsigned char)*p)) ++p;
+    wrapped = p < stop && *p != '{';
+    if (wrapped) {
+        // keywords and the variable name (window.GRAPH_DATA too), then '='
+        while (p < stop && (isalnum((unsigned char)*p) || *p == '_' || *p == '$' || *p == '.' || isspace((unsigned char)*p))) ++p;
+        if (p == stop || *p != '=') return false;
+        ++p;
+        while (p < stop && isspace((unsigned char)*p)) ++p;
+        if (p == stop || *p != '{') return false;
     }
-    distances[startIndex] = 0;
-    
-    // 2. Create Priority Queue
-    MinPriorityQueue pq(V * V); 
-    pq.insert(startIndex, 0);
+    if (p == stop) return false;
+    begin = p;
+    end = stop;
+    while (end > begin && isspace((unsigned char)end[-1])) --end;
+    if (wrapped && end > begin && end[-1] == ';') {
+        --end;
+        while (end > begin && isspace((unsigned char)end[-1])) --end;
+    }
+    return true;
+}
 
-    // 3. Main Loop
-    while (!pq.isEmpty()) {
-        HeapNode minNode = pq.extractMin();
-        int u = minNode.nodeIndex;
-        int u_dist = minNode.distance;
+// Streams the JSON graph through GraphSaxBuilder from 'offset' on. For the
+// wrapped form the parse stops after the object instead of requiring the
+// end of the file. Errors are printed; returns null.
+ManualGraph* loadJsonGraphSax(const char* filename, long long offset, bool wrapped) {
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr) {
+        cerr << "Error: Could not open file '" << filename << "'" << endl;
+        return nullptr;
+    }
+    GraphSaxBuilder builder;
+    fseek(file, offset, SEEK_SET);
+    bool parsed = json::sax_parse(file, &builder, json::input_format_t::json, !wrapped);
+    fclose(file);
+    if (!parsed) {
+        cerr << "Error: Failed to parse JSON file." << endl;
+        cerr << builder.error << endl;
+        return nullptr;
+    }
+    return builder.staging.build();
+}
 
-        if (u_dist > distances[u]) {
-            continue;
-        }
-        
-        // If we found the end node, we can stop.
-        if (u == endIndex) {
-            break;
+// Reads the JSON graph (plain or graph_data.js) with the chosen loader and
+// freezes it in the given order. The schema loader parses the mapped text in
+// place and hands unexpected input to the SAX loader; 'used' tells which one
+// built the graph. Errors are printed; returns null.
+ManualGraph* loadJsonGraph(const char* filename, GraphLoader loader, NodeOrder nodeOrder, GraphLoader& used) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        cerr << "Error: Could not open file '" << filename << "'" << endl;
+        return nullptr;
+    }
+    const char* begin;
+    const char* end;
+    bool wrapped;
+    if (!findJsonDocument(file.data, file.size, begin, end, wrapped)) {
+        cerr << "Error: '" << filename << "' holds neither a JSON graph nor a `const NAME = {...};` wrapper" << endl;
+        return nullptr;
+    }
+    ManualGraph* graph = nullptr;
+    used = loader;
+    if (loader == LOADER_SCHEMA) {
+        GraphStaging staging;
+        SchemaGraphParser parser(begin, end - begin, staging);
+        if (parser.parse()) graph = staging.build();
+        else used = LOADER_SAX;
+    }
+    if (used == LOADER_SAX) {
+        graph = loadJsonGraphSax(filename, begin - file.data, wrapped);
+    } else if (used == LOADER_DOM) {
+        json data;
+        try {
+            data = json::parse(begin, end);
+        } catch (json::parse_error& e) {
+            cerr << "Error: Failed to parse JSON file." << endl;
+            cerr << e.what() << endl;
+            return nullptr;
         }
+        graph = buildGraphFromDom(data);
+    }
+    if (graph != nullptr) graph->freeze(nodeOrder);
+    return graph;
+}
 
-        // Loop over all neighbors
-        AdjListNode* neighbor = graph->adjLists[u];
-        while (neighbor != nullptr) {
-            int v = neighbor->destIndex;
-            int weight = neighbor->weight;
-            int newDist = distances[u] + weight;
-            if (newDist < distances[v]) {
-                distances[v] = newDist;
-                previous[v] = u;
-                pq.insert(v, newDist);
+// Parse + build time of the three loaders on one JSON text held in memory
+// (freeze() is the same for all of them and left out).
+void benchLoadersOn(const string& text, const char* label, int rounds) {
+    double megabytes = text.size() / 1e6;
+    cout << label << " (" << megabytes << " MB, " << rounds << " rounds)" << endl;
+    long long reference = -1;
+    GraphLoader loaders[3] = {LOADER_DOM, LOADER_SAX, LOADER_SCHEMA};
+    for (int l = 0; l < 3; ++l) {
+        long long checksum = 0;
+        bool ok = true;
+        auto start = chrono::steady_clock::now();
+        for (int r = 0; r < rounds && ok; ++r) {
+            ManualGraph* graph = nullptr;
+            if (loaders[l] == LOADER_DOM) {
+                json data = json::parse(text.data(), text.data() + text.size());
+                graph = buildGraphFromDom(data);
+            } else if (loaders[l] == LOADER_SAX) {
+                GraphSaxBuilder builder;
+                if (json::sax_parse(text.data(), text.data() + text.size(), &builder)) graph = builder.staging.build();
+            } else {
+                GraphStaging staging;
+                SchemaGraphParser parser(text.data(), (long long)text.size(), staging);
+                if (parser.parse()) graph = staging.build();
             }
-            neighbor = neighbor->next;
+            if (graph == nullptr) {
+                ok = false;
+                break;
+            }
+            checksum += graph->numVertices * 1000003LL + graph->numEdges;
+            delete graph;
+        }
+        double millis = millisSince(start);
+        if (!ok) {
+            cout << "  " << loaderName(loaders[l]) << ": could not parse" << endl;
+            continue;
         }
+        if (reference == -1) reference = checksum;
+        cout << "  " << loaderName(loaders[l]) << ": " << millis / rounds << " ms, "
+             << megabytes * rounds / (millis / 1000.0) << " MB/s"
+             << (checksum == reference ? "" : "  (GRAPHS DIFFER)") << endl;
     }
+}
 
-    // Store results in the struct
-    result.distance = distances[endIndex];
-    result.previous = previous; 
-    result.startIndex = startIndex;
-    result.endIndex = endIndex;
+void benchLoaders(const char* filename) {
+    MappedFile file;
+    const char* begin;
+    const char* end;
+    bool wrapped;
+    if (file.open(filename) && findJsonDocument(file.data, file.size, begin, end, wrapped)) {
+        benchLoadersOn(string(begin, end), filename, 200);
+    }
+    // campus-shaped grids in the same schema
+    int sides[2] = {100, 500};
+    for (int i = 0; i < 2; ++i) {
+        int side = sides[i];
+        string grid = "{\"metadata\": {\"imageWidth\": 3960, \"imageHeight\": 3771}, \"nodes\": [";
+        char item[256];
+        for (int k = 0; k < side * side; ++k) {
+            snprintf(item, sizeof(item), "%s{\"id\": \"G%d_%d\", \"type\": \"hallway\", \"x\": %d, \"y\": %d}",
+                     k > 0 ? ", " : "", k / side, k % side, (k % side) * 100, (k / side) * 100);
+            grid += item;
+        }
+        grid += "], \"edges\": [";
+        unsigned int state = 2024;
+        bool first = true;
+        for (int r = 0; r < side; ++r) {
+            for (int c = 0; c < side; ++c) {
+                for (int dir = 0; dir < 2; ++dir) {
+                    int r2 = r + dir;
+                    int c2 = c + 1 - dir;
+                    if (r2 >= side || c2 >= side) continue;
+                    int weight = 500 + (int)(benchRandom(state) % 1001);
+                    snprintf(item, sizeof(item), "%s{\"source\": \"G%d_%d\", \"target\": \"G%d_%d\", \"weight\": %d}, "
+                             "{\"source\": \"G%d_%d\", \"target\": \"G%d_%d\", \"weight\": %d}",
+                             first ? "" : ", ", r, c, r2, c2, weight, r2, c2, r, c, weight);
+                    grid += item;
+                    first = false;
+                }
+            }
+        }
+        grid += "]}";
+        char label[64];
+        snprintf(label, sizeof(label), "synthetic grid %dx%d", side, side);
+        benchLoadersOn(grid, label, side >= 500 ? 2 : 10);
+    }
+}
 
-    delete[] distances;
+// Writes a header for the embedded build: every snapshot section (node
+// attributes, name table, CSR edge blocks, perfect hash, prefix index and
+// door groups, see ManualGraph::writeSections) as a typed constexpr array,
+// then the header words and the section table that
+// ManualGraph::attachEmbedded() reads.
+bool writeEmbeddedHeader(const ManualGraph& graph, const char* filename, const char* source) {
+    ofstream out(filename);
+    if (!out.is_open()) return false;
+    string escaped;
+    for (const char* c = source; *c; ++c) {
+        if (*c == '"' || *c == '\\') escaped += '\\';
+        escaped += *c;
+    }
+    out << "// Generated by pathfinder --emit-header from \"" << escaped << "\"; do not edit.\n"
+        << "// Build the embedded variant with -DEMBEDDED_GRAPH='\"" << filename << "\"'.\n"
+        << "#pragma once\n\n"
+        << "constexpr const char* EMBEDDED_GRAPH_SOURCE = \"" << escaped << "\";\n"
+        << "constexpr int EMBEDDED_GRAPH_NODES = " << graph.numVertices << ";\n"
+        << "constexpr int EMBEDDED_GRAPH_EDGES = " << graph.numEdges << ";\n\n";
+    SnapshotWriter sections(out, true);
+    long long header[ManualGraph::SNAPSHOT_HEADER_WORDS] = {0};
+    if (!graph.writeSections(sections, header)) return false;
+    header[3] = 0; // no checksum, the arrays are compiled in
+    out << "\nconstexpr long long EMBEDDED_GRAPH_HEADER[] = {";
+    for (int i = 0; i < ManualGraph::SNAPSHOT_HEADER_WORDS; ++i) out << (i > 0 ? ", " : "") << header[i] << "LL";
+    out << "};\n"
+        << "constexpr EmbeddedSection EMBEDDED_GRAPH_SECTIONS[] = {\n" << sections.sectionTable << "};\n"
+        << "constexpr int EMBEDDED_GRAPH_NUM_SECTIONS = " << sections.numSections << ";\n";
+    return out.good();
 }
 
+// Embedded build: -DEMBEDDED_GRAPH='"campus_graph.h"' compiles in a header
+// written by --emit-header, and the graph is used from it with no file I/O.
+#ifdef EMBEDDED_GRAPH
+#include EMBEDDED_GRAPH
+#endif
 
+int main(int argc, char* argv[]) {
+    SearchEngine engine = ENGINE_DIJKSTRA;
+    bool showStats = false;
+    const char* landmarkFile = nullptr;
+    int landmarkCount = DEFAULT_LANDMARKS;
+    int tableLimit = DEFAULT_TABLE_LIMIT;
+    QueueBackend queueBackend = DIJKSTRA_QUEUE;
+    NodeOrder nodeOrder = ORDER_INPUT;
+    bool packedEdges = false;
+    GraphLoader loader = LOADER_SCHEMA;
+    GraphLoader usedLoader = loader;
+    const char* filename = "graph (4).json"; // JSON or graph_data.js, --graph or the first plain argument
+    const char* snapshotFile = nullptr;    // mapped instead of parsing the JSON
+    const char* compileSnapshot = nullptr; // JSON -> snapshot, then exit
+    const char* emitHeader = nullptr;      // JSON -> header for the embedded build, then exit
+    const char* benchName = nullptr;
+    bool graphGiven = false;
+    bool orderGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            if (!parseEngine(argv[++i], engine)) {
+                cerr << "Error: Unknown engine '" << argv[i] << "'" << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            showStats = true;
+        } else if (strcmp(argv[i], "--landmarks") == 0 && i + 1 < argc) {
+            landmarkFile = argv[++i];
+        } else if (strcmp(argv[i], "--landmark-count") == 0 && i + 1 < argc) {
+            landmarkCount = atoi(argv[++i]);
+            if (landmarkCount <= 0) landmarkCount = DEFAULT_LANDMARKS;
+        } else if (strcmp(argv[i], "--table-limit") == 0 && i + 1 < argc) {
+            tableLimit = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queue") == 0 && i + 1 < argc) {
+            if (!parseQueue(argv[++i], queueBackend)) {
+                cerr << "Error: Unknown queue '" << argv[i] << "'" << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc) {
+            if (!parseOrder(argv[++i], nodeOrder)) {
+                cerr << "Error: Unknown node order '" << argv[i] << "'" << endl;
+                return 1;
+            }
+            orderGiven = true;
+        } else if (strcmp(argv[i], "--edges") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "packed") == 0) {
+                packedEdges = true;
+            } else if (strcmp(argv[i], "plain") != 0) {
+                cerr << "Error: Unknown edge format '" << argv[i] << "'" << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--loader") == 0 && i + 1 < argc) {
+            if (!parseLoader(argv[++i], loader)) {
+                cerr << "Error: Unknown loader '" << argv[i] << "'" << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--graph") == 0 && i + 1 < argc) {
+            filename = argv[++i];
+            graphGiven = true;
+        } else if (argv[i][0] != '-' && !graphGiven) {
+            filename = argv[i];
+            graphGiven = true;
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        } else if (strcmp(argv[i], "--compile-snapshot") == 0 && i + 1 < argc) {
+            compileSnapshot = argv[++i];
+        } else if (strcmp(argv[i], "--emit-header") == 0 && i + 1 < argc) {
+            emitHeader = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchName = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [graph.json|graph_data.js] [--graph file]"
+                 << " [--engine dijkstra|astar|bidirectional|ch|alt|table|hub] [--stats]"
+                 << " [--landmarks file] [--landmark-count K] [--table-limit V]"
+                 << " [--queue heap|radix|dial] [--order input|hilbert|bfs|rcm] [--edges plain|packed]"
+                 << " [--loader dom|sax|schema] [--snapshot file] [--compile-snapshot file] [--emit-header file.h]"
+                 << " [--bench queues|layout|hash|doors|fuzzy|order|edges|loaders]" << endl;
+            return 1;
+        }
+    }
 
-int main() {
     // Load and Parse JSON file (this is by help of lib documentation and prevoius implementation) 
-    const char* filename = "graph (4).json"; // Make sure this matches your file
-    
-    ifstream json_file(filename);
-    if (!json_file.is_open()) {
-        cerr << "Error: Could not open file '" << filename << "'" << endl;
-        return 1;
+    auto loadStart = chrono::steady_clock::now();
+    ManualGraph* loadedGraph;
+    bool embedded = false;
+    if (snapshotFile != nullptr) {
+        string error;
+        loadedGraph = ManualGraph::mapSnapshot(snapshotFile, error);
+        if (loadedGraph == nullptr) {
+            cerr << "Error: Could not load snapshot '" << snapshotFile << "': " << error << endl;
+            return 1;
+        }
+        filename = snapshotFile;
+#ifdef EMBEDDED_GRAPH
+    } else if (!graphGiven) {
+        string error;
+        loadedGraph = ManualGraph::attachEmbedded(EMBEDDED_GRAPH_HEADER, EMBEDDED_GRAPH_SECTIONS,
+                                                  EMBEDDED_GRAPH_NUM_SECTIONS, error);
+        if (loadedGraph == nullptr) {
+            cerr << "Error: Embedded graph unusable: " << error << endl;
+            return 1;
+        }
+        filename = EMBEDDED_GRAPH_SOURCE;
+        embedded = true;
+#endif
+    } else {
+        loadedGraph = loadJsonGraph(filename, loader, nodeOrder, usedLoader);
+        if (loadedGraph == nullptr) return 1;
     }
-    json data;
-    try {
-        data = json::parse(json_file);
-    } catch (json::parse_error& e) {
-        cerr << "Error: Failed to parse JSON file." << endl;
-        cerr << e.what() << endl;
+    double loadMillis = millisSince(loadStart);
+    ManualGraph& buildingGraph = *loadedGraph;
+    if (orderGiven && buildingGraph.nodeOrder != nodeOrder) {
+        // a snapshot keeps the numbering it was compiled with
+        cerr << "Warning: --order " << orderName(nodeOrder) << " ignored, '" << filename << "' is frozen in order "
+             << orderName(buildingGraph.nodeOrder) << "; recompile it with --order" << endl;
+    }
+    if ((compileSnapshot != nullptr || emitHeader != nullptr) && buildingGraph.unnamedNodes() > 0) {
+        cerr << "Error: '" << filename << "' repeats " << buildingGraph.unnamedNodes()
+             << " node id(s); give every node a unique id before compiling it" << endl;
+        delete loadedGraph;
         return 1;
     }
-    json_file.close();
-
-    // build graph
-    int numNodes = data["nodes"].size();
-    ManualGraph buildingGraph(numNodes);
-    for (const auto& node : data["nodes"]) {
-        string id = node["id"].get<string>();
-        buildingGraph.addNode(id.c_str());
+    if (compileSnapshot != nullptr) {
+        if (!buildingGraph.writeSnapshot(compileSnapshot)) {
+            cerr << "Error: Could not write snapshot '" << compileSnapshot << "'" << endl;
+            delete loadedGraph;
+            return 1;
+        }
+        cout << "Snapshot '" << compileSnapshot << "' written (" << buildingGraph.numVertices << " nodes, "
+             << buildingGraph.numEdges << " edges, node order " << orderName(buildingGraph.nodeOrder) << ")." << endl;
+        delete loadedGraph;
+        return 0;
     }
-    int edgeCount = 0;
-    for (const auto& edge : data["edges"]) {
-        string source = edge["source"].get<string>();
-        string target = edge["target"].get<string>();
-        int weight = edge["weight"].get<int>();
-        buildingGraph.addEdge(source.c_str(), target.c_str(), weight);
-        edgeCount++;
+    if (emitHeader != nullptr) {
+        if (!writeEmbeddedHeader(buildingGraph, emitHeader, filename)) {
+            cerr << "Error: Could not write header '" << emitHeader << "'" << endl;
+            delete loadedGraph;
+            return 1;
+        }
+        cout << "Header '" << emitHeader << "' written (" << buildingGraph.numVertices << " nodes, "
+             << buildingGraph.numEdges << " edges, node order " << orderName(buildingGraph.nodeOrder) << ")." << endl;
+        delete loadedGraph;
+        return 0;
+    }
+    if (packedEdges && !buildingGraph.packEdges()) {
+        cerr << "Warning: edge weights do not fit the packed format, keeping plain edges" << endl;
     }
     cout << "Graph '" << filename << "' loaded successfully." << endl;
+
+    if (benchName != nullptr) {
+        if (strcmp(benchName, "queues") == 0) {
+            benchQueues(&buildingGraph);
+        } else if (strcmp(benchName, "layout") == 0) {
+            benchLayout();
+        } else if (strcmp(benchName, "hash") == 0) {
+            benchHash();
+        } else if (strcmp(benchName, "doors") == 0) {
+            benchDoors(&buildingGraph);
+        } else if (strcmp(benchName, "fuzzy") == 0) {
+            benchFuzzy(&buildingGraph);
+        } else if (strcmp(benchName, "order") == 0) {
+            benchOrder();
+        } else if (strcmp(benchName, "edges") == 0) {
+            benchEdges(&buildingGraph);
+        } else if (strcmp(benchName, "loaders") == 0) {
+            benchLoaders(filename);
+        } else {
+            cerr << "Error: Unknown benchmark '" << benchName << "'" << endl;
+            return 1;
+        }
+        delete loadedGraph;
+        return 0;
+    }
+
+    if (effectiveQueue(queueBackend, buildingGraph.maxEdgeWeight) != queueBackend) {
+        cout << "Queue: dial would need " << (long long)buildingGraph.maxEdgeWeight + 1
+             << " buckets, using radix instead" << endl;
+    }
+
+    // preprocessing for the engines that need it
+    if (engine == ENGINE_CH) {
+        buildingGraph.ch = new ContractionHierarchy(&buildingGraph);
+        cout << "Contraction hierarchy: " << buildingGraph.ch->numShortcuts << " shortcuts over "
+             << buildingGraph.ch->numOriginalEdges << " edges, built in "
+             << buildingGraph.ch->preprocessMillis << " ms" << endl;
+    }
+    if (engine == ENGINE_ALT) {
+        // reuse the persisted tables when they match this graph
+        buildingGraph.landmarks = new LandmarkTable();
+        if (landmarkFile != nullptr && buildingGraph.landmarks->load(landmarkFile, &buildingGraph)) {
+            cout << "Landmarks loaded from '" << landmarkFile << "'";
+        } else {
+            buildingGraph.landmarks->build(&buildingGraph, landmarkCount);
+            cout << "Landmarks built in " << buildingGraph.landmarks->preprocessMillis << " ms";
+            if (landmarkFile != nullptr && buildingGraph.landmarks->save(landmarkFile)) {
+                cout << ", saved to '" << landmarkFile << "'";
+            }
+        }
+        cout << ": " << buildingGraph.landmarks->numLandmarks << " landmarks, "
+             << buildingGraph.landmarks->memoryBytes() << " bytes" << endl;
+    }
+    if (engine == ENGINE_TABLE) {
+        if (buildingGraph.numVertices <= tableLimit) {
+            buildingGraph.table = new DistanceTable(&buildingGraph);
+            cout << "Distance table built in " << buildingGraph.table->preprocessMillis << " ms on "
+                 << buildingGraph.table->threadsUsed << " threads: "
+                 << buildingGraph.table->memoryBytes() << " bytes" << endl;
+        } else {
+            cout << "Graph has more than " << tableLimit << " nodes, searching on demand instead of a distance table" << endl;
+            engine = ENGINE_DIJKSTRA;
+        }
+    }
+    if (engine == ENGINE_HUB) {
+        // the contraction order makes a good hub order
+        if (buildingGraph.ch == nullptr) buildingGraph.ch = new ContractionHierarchy(&buildingGraph);
+        HubLabels* labels = new HubLabels(&buildingGraph);
+        buildingGraph.hubLabels = labels;
+        cout << "Hub labels built in " << labels->preprocessMillis << " ms: " << labels->totalEntries()
+             << " entries, " << (double)labels->totalEntries() / (2.0 * buildingGraph.numVertices)
+             << " avg / " << labels->maxLabelSize() << " max per label, "
+             << labels->memoryBytes() << " bytes" << endl;
+    }
     
     
-    char startInput[50];
-    char endInput[50];
+    string startInput;
+    string endInput;
 
     cout << "Enter Start Node (e.g., CP30 or E3): ";
     cin >> startInput;
     cout << "Enter End Node (e.g., CP32 or P061): ";
     cin >> endInput;
     
-    // find node variations to solve doors problem
-    StringList* startNodes = findNodeVariations(&buildingGraph, startInput);
-    StringList* endNodes = findNodeVariations(&buildingGraph, endInput);
+    // resolve rooms to their doors to solve doors problem
+    const int* startIndices;
+    const int* endIndices;
+    int* startBuffer;
+    int* endBuffer;
+    int numStarts = resolveTypedName(&buildingGraph, startInput, startIndices, startBuffer);
+    int numEnds = resolveTypedName(&buildingGraph, endInput, endIndices, endBuffer);
 
-    if (startNodes->count == 0) {
+    if (numStarts == 0) {
         cout << "Error: Start node '" << startInput << "' not found." << endl;
+        printSuggestions(&buildingGraph, startInput);
         return 1;
     }
-    if (endNodes->count == 0) {
+    if (numEnds == 0) {
         cout << "Error: End node '" << endInput << "' not found." << endl;
+        printSuggestions(&buildingGraph, endInput);
         return 1;
     }
 
-    // Run Dijkstra for all combinations 
-    
-    PathResult bestResult; 
-
-    // Loop for each start variation
-    for (StringNode* start = startNodes->head; start != nullptr; start = start->next) {
-        int startIndex = buildingGraph.nodeMap->get(start->name);
-        if (startIndex == -1) continue;
-
-        // Loop for each end variation
-        for (StringNode* end = endNodes->head; end != nullptr; end = end->next) {
-            int endIndex = buildingGraph.nodeMap->get(end->name);
-            if (endIndex == -1) continue;
-
-            PathResult currentResult;
-            dijkstra(&buildingGraph, startIndex, endIndex, currentResult);
-
-            if (currentResult.distance < bestResult.distance) {
-                
-                if (bestResult.previous != nullptr) {
-                    delete[] bestResult.previous;
-                }
-                bestResult = currentResult; 
-            } else {
-                if (currentResult.previous != nullptr) {
-                    delete[] currentResult.previous;
-                }
-            }
-        }
-    }
+    // Run a single search over all door combinations
+    PathResult bestResult;
+    SearchWorkspace workspace;
+    workspace.prepare(buildingGraph.numVertices); // allocated once, outside the timed query
+    auto queryStart = chrono::steady_clock::now();
+    findPath(&buildingGraph, engine, startIndices, numStarts, endIndices, numEnds, bestResult, workspace, tableLimit,
+             queueBackend);
+    double queryMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - queryStart).count();
+    delete[] startBuffer;
+    delete[] endBuffer;
     
     if (bestResult.distance == INF || bestResult.previous == nullptr) {
         cout << "No path found from '" << startInput << "' to '" << endInput << "'." << endl;
     } else {
         cout << " Found " << endl;
         
-        const char* bestStartName = buildingGraph.indexToName[bestResult.startIndex];
-        const char* bestEndName = buildingGraph.indexToName[bestResult.endIndex];
+        const char* bestStartName = buildingGraph.nameOf(bestResult.startIndex);
+        const char* bestEndName = buildingGraph.nameOf(bestResult.endIndex);
         
         cout << "From: " << startInput << " (via " << bestStartName << ")" << endl;
         cout << "To:   " << endInput << " (via " << bestEndName << ")" << endl;
@@ -474,29 +5771,49 @@ int main() {
         // Reconstruct path
         PathStack path;
         int current = bestResult.endIndex;
-        while (current != -1) {
+        int steps = 0; // a simple path has at most V nodes; more means a broken parent array
+        while (current != -1 && steps++ < buildingGraph.numVertices) {
             path.push(current);
             if (current == bestResult.startIndex) break;
             current = bestResult.previous[current];
         }
+        if (current != bestResult.startIndex) {
+            cout << "Error: could not rebuild the path from the search result." << endl;
+            delete loadedGraph;
+            return 1;
+        }
 
         // Print path
         while (!path.isEmpty()) {
             int nodeIndex = path.pop();
-            cout << buildingGraph.indexToName[nodeIndex];
+            cout << buildingGraph.nameOf(nodeIndex);
             if (!path.isEmpty()) {
                 cout << " -> ";
             }
         }
         cout << endl;
     }
-
-            // Clean up
-    delete startNodes;
-    delete endNodes;
-    if (bestResult.previous != nullptr) {
-        delete[] bestResult.previous; 
+    if (showStats) {
+        cout << "Engine: " << engineName(engine) << ", settled nodes: " << bestResult.settled
+             << ", query time: " << queryMillis << " ms" << endl;
+        int stored = buildingGraph.storedEdgeEntries();
+        cout << "Edges: " << buildingGraph.numEdges << " directed, " << buildingGraph.numUndirected
+             << " stored once as undirected pairs, " << buildingGraph.numOneWay << " one-way; "
+             << stored << " edge entries (" << buildingGraph.edgeBytes() << " bytes) instead of "
+             << 2 * buildingGraph.numEdges << " (" << 2 * buildingGraph.numEdges * 2 * sizeof(int)
+             << " bytes) in separate out/in arrays" << endl;
+        if (embedded) {
+            cout << "Startup: " << loadMillis << " ms to attach the embedded graph" << endl;
+        } else if (snapshotFile != nullptr) {
+            cout << "Startup: " << loadMillis << " ms to map the snapshot" << endl;
+        } else {
+            ifstream sized(filename, ios::binary | ios::ate);
+            double megabytes = sized.is_open() ? (double)sized.tellg() / 1e6 : 0.0;
+            cout << "Startup: " << loadMillis << " ms to parse and build the graph (" << loaderName(usedLoader)
+                 << " loader" << (usedLoader != loader ? " after schema fallback" : "") << ", " << megabytes << " MB, " << megabytes / (loadMillis / 1000.0) << " MB/s)" << endl;
+        }
     }
 
+    delete loadedGraph;
     return 0;
 }
\ No newline at end of file